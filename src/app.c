@@ -0,0 +1,341 @@
+#include "tetris.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+App* App_Init(const GameConfig* config, const InputConfig* inputConfig)
+{
+    // Zeroed, so every asset is a harmless empty one until it has loaded
+    App* app = calloc(1, sizeof(App));
+    assert(app != NULL);
+    Game_Init(&app->game, config);
+    app->lastTime = GetTime();
+    app->accumulator = 0;
+    Input_Init(&app->input, inputConfig);
+    app->replayFile = NULL;
+    const bool rewindReady = Rewind_Init(&app->rewind, (size_t)REWIND_SECONDS * config->tickRate);
+    assert(rewindReady);
+    (void)rewindReady;
+    Rewind_Push(&app->rewind, &app->game);
+    app->rewinding = false;
+    app->restartQueued = false;
+    app->previousBlock = app->game.currentBlock;
+    app->previousPieces = app->game.pieces;
+
+    app->boardLayer = BoardLayer_Load();
+    app->hud = Hud_Load();
+    AssetLoader_Start(&app->loader);
+
+    return app;
+}
+
+bool App_Record(App* app, const char* path)
+{
+    assert(app->game.ticks == 0 && app->replayFile == NULL);
+    app->replayFile = fopen(path, "wb");
+    if (!app->replayFile)
+        return false;
+    ReplayWriter_Open(&app->replay, app->replayFile, &app->game.config);
+    return true;
+}
+
+void App_Close(App* app)
+{
+    if (app->replayFile) {
+        if (!ReplayWriter_Close(&app->replay, &app->game))
+            TraceLog(LOG_WARNING, "Failed to write replay");
+        fclose(app->replayFile);
+    }
+
+    if (app->profilePath && !Profiler_Dump(&app->profiler, app->profilePath))
+        TraceLog(LOG_WARNING, "Cannot write profile to %s", app->profilePath);
+
+    AssetLoader_Finish(&app->loader);
+    UnloadSound(app->rotateSound);
+    UnloadSound(app->clearSound);
+    UnloadSound(app->moveSound);
+    UnloadSound(app->hardDropSound);
+    UnloadSound(app->softDropSound);
+    MusicPlayer_Unload(&app->music);
+
+    UnloadFont(app->font);
+    UnloadTexture(app->tileSpriteSheet);
+    BoardLayer_Unload(&app->boardLayer);
+    Hud_Unload(&app->hud);
+    Rewind_Free(&app->rewind);
+    if (app->loader.audioReady)
+        CloseAudioDevice();
+    free(app);
+}
+
+static Sound takeSound(App* app, Wave wave)
+{
+    Sound sound = { 0 };
+    if (AssetLoader_IsAudioReady(&app->loader))
+        sound = LoadSoundFromWave(wave);
+    UnloadWave(wave);
+    return sound;
+}
+
+// Finishes whatever the loader has decoded since the last frame: texture
+// uploads and audio objects, which must be created on this thread.
+void App_PollAssets(App* app)
+{
+    AssetId id;
+    Asset asset;
+    while (AssetLoader_Take(&app->loader, &id, &asset)) {
+        app->redraw = true;
+        switch (id) {
+        case ASSET_TILES:
+            app->tileSpriteSheet = LoadTextureFromImage(asset.image);
+            SetTextureFilter(app->tileSpriteSheet, TEXTURE_FILTER_POINT);
+            UnloadImage(asset.image);
+            app->boardLayer.valid = false;
+            app->hud.valid = false;
+            break;
+        case ASSET_FONT:
+            if (asset.file.data) {
+                app->font = LoadFontFromMemory(asset.file.fileType, asset.file.data, asset.file.size,
+                    FONT_LOAD_SIZE, NULL, 0);
+            }
+            app->hud.valid = false;
+            break;
+        case ASSET_ROTATE_SOUND:
+            app->rotateSound = takeSound(app, asset.wave);
+            break;
+        case ASSET_CLEAR_SOUND:
+            app->clearSound = takeSound(app, asset.wave);
+            break;
+        case ASSET_MOVE_SOUND:
+            app->moveSound = takeSound(app, asset.wave);
+            break;
+        case ASSET_HARD_DROP_SOUND:
+            app->hardDropSound = takeSound(app, asset.wave);
+            break;
+        case ASSET_SOFT_DROP_SOUND:
+            app->softDropSound = takeSound(app, asset.wave);
+            break;
+        case ASSET_MUSIC:
+            if (asset.file.data && AssetLoader_IsAudioReady(&app->loader)) {
+                if (!MusicPlayer_Load(&app->music, &asset.file))
+                    TraceLog(LOG_WARNING, "Cannot play the music");
+            }
+            break;
+        case NUM_ASSETS:
+            break;
+        }
+    }
+}
+
+void App_Update(App* app)
+{
+    Profiler* profiler = &app->profiler;
+    Profiler_BeginFrame(profiler);
+
+    Profiler_Begin(profiler);
+    App_PollAssets(app);
+    Profiler_End(profiler, PHASE_ASSETS);
+
+    Profiler_Begin(profiler);
+    App_HandleInput(app);
+    Profiler_End(profiler, PHASE_INPUT);
+
+    Profiler_Begin(profiler);
+    if (app->game.gameOver)
+        MusicPlayer_Stop(&app->music);
+    else
+        MusicPlayer_Play(&app->music);
+    Profiler_End(profiler, PHASE_AUDIO);
+
+    // Run as many fixed ticks as the elapsed time pays for. A long hitch is
+    // capped at MAX_FRAME_TIME so the game does not race to catch up.
+    const double tickSeconds = 1.0 / app->game.config.tickRate;
+    const double now = GetTime();
+    const double elapsed = now - app->lastTime;
+    app->lastTime = now;
+    app->accumulator += elapsed < MAX_FRAME_TIME ? elapsed : MAX_FRAME_TIME;
+    Profiler_Begin(profiler);
+    while (app->accumulator >= tickSeconds) {
+        App_Step(app);
+        app->accumulator -= tickSeconds;
+    }
+    Profiler_End(profiler, PHASE_SIMULATION);
+
+    Profiler_Begin(profiler);
+    App_PlayEvents(app);
+    Profiler_End(profiler, PHASE_AUDIO);
+}
+
+// One simulation tick: the input due on it, then gravity. While rewinding,
+// input is discarded and each tick steps back to the previous one instead.
+void App_Step(App* app)
+{
+    app->previousBlock = app->game.currentBlock;
+    app->previousPieces = app->game.pieces;
+
+    if (app->rewinding) {
+        Action discarded[INPUT_MAX_ACTIONS];
+        Input_Tick(&app->input, UINT32_MAX, discarded);
+        app->restartQueued = false;
+        if (Rewind_Back(&app->rewind, 1, &app->game)) {
+            // The board may go back to an earlier revision number and then
+            // reach it again with different cells, so the layer can't trust it
+            app->boardLayer.valid = false;
+            app->game.events = 0;
+            app->redraw = true;
+        }
+        return;
+    }
+
+    const uint32_t revision = app->game.board.revision;
+
+    Action actions[INPUT_MAX_ACTIONS];
+    const size_t count = Input_Tick(&app->input, app->game.ticks, actions);
+    app->restartQueued = false;
+    for (size_t i = 0; i < count; i++) {
+        if (app->replayFile)
+            ReplayWriter_Action(&app->replay, app->game.ticks, actions[i]);
+        Game_Apply(&app->game, actions[i]);
+    }
+
+    Game_Advance(&app->game);
+    Game_UpdateShadowBlock(&app->game);
+    Rewind_Push(&app->rewind, &app->game);
+
+    // Score, lines, the next piece and game over only change along with the
+    // board or the active block
+    if (app->game.board.revision != revision || app->game.pieces != app->previousPieces
+        || memcmp(&app->game.currentBlock, &app->previousBlock, sizeof(Block)) != 0)
+        app->redraw = true;
+}
+
+bool App_NeedsRedraw(App* app)
+{
+    // The active block slides towards where it moved on the last tick for
+    // the whole of the next one
+    const bool sliding = memcmp(&app->game.currentBlock, &app->previousBlock, sizeof(Block)) != 0;
+    return app->redraw || sliding || app->profiler.overlay || AssetLoader_Progress(&app->loader) < 1
+        || GetTime() - app->lastDrawTime >= IDLE_REFRESH_INTERVAL;
+}
+
+void App_Wait(App* app)
+{
+    // The frame drew nothing, but its other phases still count; the sleep
+    // doesn't
+    Profiler_EndFrame(&app->profiler);
+
+    // Input only takes effect on a tick, so waiting for the next one adds
+    // no latency. After game over nothing happens until a key is pressed.
+    double wait = IDLE_GAME_OVER_WAIT;
+    if (!app->game.gameOver) {
+        const double tickSeconds = 1.0 / app->game.config.tickRate;
+        wait = tickSeconds - app->accumulator - (GetTime() - app->lastTime);
+    }
+    if (wait > 0)
+        WaitTime(wait);
+    PollInputEvents();
+}
+
+void App_PlayEvents(App* app)
+{
+    const uint32_t events = Game_TakeEvents(&app->game);
+
+    if (events & GAME_EVENT_ROTATE)
+        PlaySound(app->rotateSound);
+    if (events & GAME_EVENT_LINE_CLEAR)
+        PlaySound(app->clearSound);
+    if (events & GAME_EVENT_HARD_DROP)
+        PlaySound(app->hardDropSound);
+    if (events & GAME_EVENT_SOFT_DROP)
+        PlaySound(app->softDropSound);
+}
+
+void App_Draw(App* app)
+{
+    const Game* game = &app->game;
+    Profiler_Begin(&app->profiler);
+    BoardLayer_Update(&app->boardLayer, &game->board, app->tileSpriteSheet);
+    Hud_Update(&app->hud, game, app->font, app->tileSpriteSheet);
+
+    BeginDrawing();
+    ClearBackground(darkBlue);
+    Hud_Draw(&app->hud);
+    BoardLayer_Draw(&app->boardLayer, BOARD_PADDING, BOARD_PADDING);
+
+    // Slide the active block from where it was at the previous tick towards
+    // where it is now, by how far we are into the next tick
+    int offsetX = BOARD_PADDING;
+    int offsetY = BOARD_PADDING;
+    if (game->pieces == app->previousPieces && game->currentBlock.rotationState == app->previousBlock.rotationState) {
+        const double remaining = 1.0 - app->accumulator * game->config.tickRate;
+        offsetX += (int)((app->previousBlock.columnOffset - game->currentBlock.columnOffset) * remaining * CELL_SIZE);
+        offsetY += (int)((app->previousBlock.rowOffset - game->currentBlock.rowOffset) * remaining * CELL_SIZE);
+    }
+    Block_Draw(&game->currentBlock, offsetX, offsetY, app->tileSpriteSheet, 1.0);
+    Block_Draw(&game->shadowBlock, 11, 11, app->tileSpriteSheet, 0.2);
+
+    const float progress = AssetLoader_Progress(&app->loader);
+    if (progress < 1)
+        DrawText(TextFormat("Loading %d%%", (int)(progress * 100)), HUD_X + 10, SCREEN_HEIGHT - 25, 20, WHITE);
+    if (app->profiler.overlay) {
+        const MusicStats music = MusicPlayer_Stats(&app->music);
+        Profiler_Draw(&app->profiler, &music);
+    }
+    EndDrawing();
+
+    app->redraw = false;
+    app->lastDrawTime = GetTime();
+
+    Profiler_End(&app->profiler, PHASE_DRAW);
+    Profiler_EndFrame(&app->profiler);
+}
+
+typedef struct
+{
+    int key;
+    Action action;
+
+} KeyBinding;
+
+static const KeyBinding KEY_BINDINGS[] = {
+    { KEY_LEFT, ACTION_MOVE_LEFT },
+    { KEY_RIGHT, ACTION_MOVE_RIGHT },
+    { KEY_DOWN, ACTION_HARD_DROP },
+    { KEY_UP, ACTION_ROTATE },
+};
+
+#define NUM_KEY_BINDINGS (sizeof(KEY_BINDINGS) / sizeof(KEY_BINDINGS[0]))
+
+// Drains every key pressed since the last frame, in order, then the
+// releases. raylib only reports input once per frame, so they are all
+// stamped with the next tick to run, the earliest one that can act on them.
+void App_HandleInput(App* app)
+{
+    // A replay can only go forwards, so there is no rewinding while recording
+    app->rewinding = app->replayFile == NULL && IsKeyDown(KEY_BACKSPACE);
+    if (IsKeyPressed(KEY_F3)) {
+        app->profiler.overlay = !app->profiler.overlay;
+        app->redraw = true;
+    }
+
+    const uint32_t tick = app->game.ticks;
+    int key;
+    while ((key = GetKeyPressed()) != 0) {
+        // One restart however many keys went down, over however many frames
+        // until a tick runs it, or the next would reset the new game too
+        if (app->game.gameOver && !app->restartQueued) {
+            Input_Push(&app->input, (InputEvent) { tick, ACTION_RESTART, true });
+            Input_Push(&app->input, (InputEvent) { tick, ACTION_RESTART, false });
+            app->restartQueued = true;
+        }
+        for (size_t i = 0; i < NUM_KEY_BINDINGS; i++) {
+            if (KEY_BINDINGS[i].key == key)
+                Input_Push(&app->input, (InputEvent) { tick, KEY_BINDINGS[i].action, true });
+        }
+    }
+
+    for (size_t i = 0; i < NUM_KEY_BINDINGS; i++) {
+        if (IsKeyReleased(KEY_BINDINGS[i].key))
+            Input_Push(&app->input, (InputEvent) { tick, KEY_BINDINGS[i].action, false });
+    }
+}
@@ -0,0 +1,30 @@
+#include "bundle.h"
+#include <string.h>
+
+static uint32_t readU32(const unsigned char* bytes)
+{
+    return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+}
+
+bool Bundle_Find(const char* name, BundleFile* file)
+{
+    if (ASSET_BUNDLE_SIZE < BUNDLE_HEADER_SIZE || memcmp(ASSET_BUNDLE, BUNDLE_MAGIC, 4) != 0)
+        return false;
+
+    const uint32_t numFiles = readU32(ASSET_BUNDLE + 4);
+    for (uint32_t i = 0; i < numFiles; i++) {
+        const unsigned char* entry = ASSET_BUNDLE + BUNDLE_HEADER_SIZE + (size_t)i * BUNDLE_ENTRY_SIZE;
+        if (strncmp((const char*)entry, name, BUNDLE_NAME_SIZE) != 0)
+            continue;
+
+        const uint32_t offset = readU32(entry + BUNDLE_NAME_SIZE + BUNDLE_TYPE_SIZE);
+        const uint32_t size = readU32(entry + BUNDLE_NAME_SIZE + BUNDLE_TYPE_SIZE + 4);
+        if (offset > ASSET_BUNDLE_SIZE || size > ASSET_BUNDLE_SIZE - offset)
+            return false;
+        file->fileType = (const char*)entry + BUNDLE_NAME_SIZE;
+        file->data = ASSET_BUNDLE + offset;
+        file->size = (int)size;
+        return true;
+    }
+    return false;
+}
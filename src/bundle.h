@@ -0,0 +1,36 @@
+#ifndef BUNDLE_H
+#define BUNDLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// The asset bundle: every file from assets/, packed into one blob by
+// tetris-pack at build time and linked into the executable. The blob is a
+// header (BUNDLE_MAGIC, then the number of files) and an index of
+// BUNDLE_ENTRY_SIZE entries, each a NUL-padded name and file type followed by
+// the offset and size of the file's data, all little-endian.
+
+#define BUNDLE_MAGIC "TBND"
+#define BUNDLE_NAME_SIZE 32
+#define BUNDLE_TYPE_SIZE 8
+#define BUNDLE_HEADER_SIZE 8
+#define BUNDLE_ENTRY_SIZE (BUNDLE_NAME_SIZE + BUNDLE_TYPE_SIZE + 8)
+
+typedef struct
+{
+    // The extension raylib's *FromMemory loaders take, such as ".png"
+    const char* fileType;
+    const unsigned char* data;
+    int size;
+
+} BundleFile;
+
+extern const unsigned char ASSET_BUNDLE[];
+extern const size_t ASSET_BUNDLE_SIZE;
+
+// Looks a file up by its path below assets/, such as "textures/tiles.png";
+// the data stays valid for the lifetime of the program.
+bool Bundle_Find(const char* name, BundleFile* file);
+
+#endif // BUNDLE_H
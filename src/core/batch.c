@@ -0,0 +1,340 @@
+#include "tetris_core.h"
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define BATCH_X86 1
+#define BATCH_TARGET(isa) __attribute__((target(isa)))
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LOAD(word) __atomic_load_n(&(word), __ATOMIC_RELAXED)
+#define STORE(word, value) __atomic_store_n(&(word), (value), __ATOMIC_RELAXED)
+#else
+#define LOAD(word) (word)
+#define STORE(word, value) ((word) = (value))
+#endif
+
+typedef struct
+{
+    // Lanes in which board row r + shift overlaps block row r for some r
+    BatchLanes (*overlap)(const BoardBatch* batch, int shift);
+    // Moves every block row of the given lanes down by one
+    void (*shiftDown)(BoardBatch* batch, BatchLanes lanes);
+    BatchLanes (*fullRows)(const BoardBatch* batch, BatchLanes full[BOARD_ROWS]);
+
+} BatchKernels;
+
+// Scalar kernels
+
+static BatchLanes overlapScalar(const BoardBatch* batch, int shift)
+{
+    BatchLanes lanes = 0;
+    for (int lane = 0; lane < BATCH_LANES; lane++) {
+        uint16_t overlap = 0;
+        for (int row = 0; row + shift < BOARD_ROWS; row++)
+            overlap |= batch->board[row + shift][lane] & batch->block[row][lane];
+        if (overlap != 0)
+            lanes |= (BatchLanes)(1u << lane);
+    }
+    return lanes;
+}
+
+static void shiftDownScalar(BoardBatch* batch, BatchLanes lanes)
+{
+    for (int lane = 0; lane < BATCH_LANES; lane++) {
+        if (!(lanes & (1u << lane)))
+            continue;
+        for (int row = BOARD_ROWS - 1; row > 0; row--)
+            batch->block[row][lane] = batch->block[row - 1][lane];
+        batch->block[0][lane] = 0;
+    }
+}
+
+static BatchLanes fullRowsScalar(const BoardBatch* batch, BatchLanes full[BOARD_ROWS])
+{
+    BatchLanes any = 0;
+    for (int row = 0; row < BOARD_ROWS; row++) {
+        full[row] = 0;
+        for (int lane = 0; lane < BATCH_LANES; lane++) {
+            if (batch->board[row][lane] == BOARD_ROW_FULL)
+                full[row] |= (BatchLanes)(1u << lane);
+        }
+        any |= full[row];
+    }
+    return any;
+}
+
+static const BatchKernels SCALAR_KERNELS = { overlapScalar, shiftDownScalar, fullRowsScalar };
+
+#ifdef BATCH_X86
+
+// movemask gives two bits per 16-bit lane; keeps one of each pair
+static BatchLanes compressLanes(uint32_t bytes)
+{
+    bytes &= 0x55555555u;
+    bytes = (bytes | (bytes >> 1)) & 0x33333333u;
+    bytes = (bytes | (bytes >> 2)) & 0x0f0f0f0fu;
+    bytes = (bytes | (bytes >> 4)) & 0x00ff00ffu;
+    bytes = (bytes | (bytes >> 8)) & 0x0000ffffu;
+    return (BatchLanes)bytes;
+}
+
+// SSE2: eight lanes per register, two registers per row
+
+BATCH_TARGET("sse2") static inline __m128i laneMaskSse2(unsigned bits)
+{
+    const __m128i values = _mm_setr_epi16(1, 2, 4, 8, 16, 32, 64, 128);
+    return _mm_cmpeq_epi16(_mm_and_si128(_mm_set1_epi16((short)bits), values), values);
+}
+
+BATCH_TARGET("sse2") static BatchLanes overlapSse2(const BoardBatch* batch, int shift)
+{
+    __m128i low = _mm_setzero_si128();
+    __m128i high = _mm_setzero_si128();
+    for (int row = 0; row + shift < BOARD_ROWS; row++) {
+        const __m128i* board = (const __m128i*)batch->board[row + shift];
+        const __m128i* block = (const __m128i*)batch->block[row];
+        low = _mm_or_si128(low, _mm_and_si128(_mm_loadu_si128(board), _mm_loadu_si128(block)));
+        high = _mm_or_si128(high, _mm_and_si128(_mm_loadu_si128(board + 1), _mm_loadu_si128(block + 1)));
+    }
+    const __m128i zero = _mm_setzero_si128();
+    const uint32_t clear = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi16(low, zero))
+        | (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi16(high, zero)) << 16;
+    return (BatchLanes)~compressLanes(clear);
+}
+
+BATCH_TARGET("sse2") static void shiftDownSse2(BoardBatch* batch, BatchLanes lanes)
+{
+    const __m128i masks[2] = { laneMaskSse2(lanes & 0xffu), laneMaskSse2(lanes >> 8) };
+    for (int row = BOARD_ROWS - 1; row >= 0; row--) {
+        __m128i* block = (__m128i*)batch->block[row];
+        for (int half = 0; half < 2; half++) {
+            const __m128i above = row > 0 ? _mm_loadu_si128((const __m128i*)batch->block[row - 1] + half)
+                                          : _mm_setzero_si128();
+            const __m128i kept = _mm_andnot_si128(masks[half], _mm_loadu_si128(block + half));
+            _mm_storeu_si128(block + half, _mm_or_si128(kept, _mm_and_si128(masks[half], above)));
+        }
+    }
+}
+
+BATCH_TARGET("sse2") static BatchLanes fullRowsSse2(const BoardBatch* batch, BatchLanes full[BOARD_ROWS])
+{
+    const __m128i target = _mm_set1_epi16((short)BOARD_ROW_FULL);
+    BatchLanes any = 0;
+    for (int row = 0; row < BOARD_ROWS; row++) {
+        const __m128i* board = (const __m128i*)batch->board[row];
+        const uint32_t bytes = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_loadu_si128(board), target))
+            | (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_loadu_si128(board + 1), target)) << 16;
+        full[row] = compressLanes(bytes);
+        any |= full[row];
+    }
+    return any;
+}
+
+static const BatchKernels SSE2_KERNELS = { overlapSse2, shiftDownSse2, fullRowsSse2 };
+
+// AVX2: all sixteen lanes of a row in one register
+
+BATCH_TARGET("avx2") static inline __m256i laneMaskAvx2(unsigned bits)
+{
+    const __m256i values = _mm256_setr_epi16(1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384,
+        (short)0x8000);
+    return _mm256_cmpeq_epi16(_mm256_and_si256(_mm256_set1_epi16((short)bits), values), values);
+}
+
+BATCH_TARGET("avx2") static BatchLanes overlapAvx2(const BoardBatch* batch, int shift)
+{
+    __m256i overlap = _mm256_setzero_si256();
+    for (int row = 0; row + shift < BOARD_ROWS; row++) {
+        const __m256i board = _mm256_loadu_si256((const __m256i*)batch->board[row + shift]);
+        const __m256i block = _mm256_loadu_si256((const __m256i*)batch->block[row]);
+        overlap = _mm256_or_si256(overlap, _mm256_and_si256(board, block));
+    }
+    const uint32_t clear = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi16(overlap, _mm256_setzero_si256()));
+    return (BatchLanes)~compressLanes(clear);
+}
+
+BATCH_TARGET("avx2") static void shiftDownAvx2(BoardBatch* batch, BatchLanes lanes)
+{
+    const __m256i mask = laneMaskAvx2(lanes);
+    for (int row = BOARD_ROWS - 1; row >= 0; row--) {
+        __m256i* block = (__m256i*)batch->block[row];
+        const __m256i above
+            = row > 0 ? _mm256_loadu_si256((const __m256i*)batch->block[row - 1]) : _mm256_setzero_si256();
+        _mm256_storeu_si256(block, _mm256_blendv_epi8(_mm256_loadu_si256(block), above, mask));
+    }
+}
+
+BATCH_TARGET("avx2") static BatchLanes fullRowsAvx2(const BoardBatch* batch, BatchLanes full[BOARD_ROWS])
+{
+    const __m256i target = _mm256_set1_epi16((short)BOARD_ROW_FULL);
+    BatchLanes any = 0;
+    for (int row = 0; row < BOARD_ROWS; row++) {
+        const __m256i board = _mm256_loadu_si256((const __m256i*)batch->board[row]);
+        full[row] = compressLanes((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi16(board, target)));
+        any |= full[row];
+    }
+    return any;
+}
+
+static const BatchKernels AVX2_KERNELS = { overlapAvx2, shiftDownAvx2, fullRowsAvx2 };
+
+#endif
+
+// Kernel selection. Racing first calls all store the same choice.
+
+static int selectedKernel = -1;
+
+bool BoardBatch_IsKernelSupported(BatchKernel kernel)
+{
+    switch (kernel) {
+    case BATCH_KERNEL_SCALAR:
+        return true;
+#ifdef BATCH_X86
+    case BATCH_KERNEL_SSE2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse2");
+    case BATCH_KERNEL_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#else
+    case BATCH_KERNEL_SSE2:
+    case BATCH_KERNEL_AVX2:
+        return false;
+#endif
+    case NUM_BATCH_KERNELS:
+        break;
+    }
+    return false;
+}
+
+BatchKernel BoardBatch_Kernel(void)
+{
+    int kernel = LOAD(selectedKernel);
+    if (kernel < 0) {
+        kernel = NUM_BATCH_KERNELS - 1;
+        while (!BoardBatch_IsKernelSupported((BatchKernel)kernel))
+            kernel--;
+        STORE(selectedKernel, kernel);
+    }
+    return (BatchKernel)kernel;
+}
+
+bool BoardBatch_UseKernel(BatchKernel kernel)
+{
+    if (!BoardBatch_IsKernelSupported(kernel))
+        return false;
+    STORE(selectedKernel, (int)kernel);
+    return true;
+}
+
+static const BatchKernels* kernels(void)
+{
+    switch (BoardBatch_Kernel()) {
+#ifdef BATCH_X86
+    case BATCH_KERNEL_SSE2:
+        return &SSE2_KERNELS;
+    case BATCH_KERNEL_AVX2:
+        return &AVX2_KERNELS;
+#else
+    case BATCH_KERNEL_SSE2:
+    case BATCH_KERNEL_AVX2:
+#endif
+    case BATCH_KERNEL_SCALAR:
+    case NUM_BATCH_KERNELS:
+        break;
+    }
+    return &SCALAR_KERNELS;
+}
+
+// Batch operations
+
+void BoardBatch_Init(BoardBatch* batch)
+{
+    memset(batch, 0, sizeof(*batch));
+}
+
+void BoardBatch_SetBoard(BoardBatch* batch, int lane, const Board* board)
+{
+    for (int row = 0; row < BOARD_ROWS; row++)
+        batch->board[row][lane] = board->rows[row];
+}
+
+void BoardBatch_SetBlock(BoardBatch* batch, int lane, const Block* block)
+{
+    const BatchLanes bit = (BatchLanes)(1u << lane);
+    for (int row = 0; row < BOARD_ROWS; row++)
+        batch->block[row][lane] = 0;
+
+    const PieceShape* shape = Block_GetShape(block);
+    const int column = block->columnOffset + shape->left;
+    if (block->rowOffset + shape->top < 0 || block->rowOffset + shape->bottom >= BOARD_ROWS || column < 0
+        || block->columnOffset + shape->right >= BOARD_COLUMNS) {
+        batch->outside |= bit;
+        return;
+    }
+    batch->outside &= (BatchLanes)~bit;
+    for (int k = shape->top; k <= shape->bottom; k++)
+        batch->block[block->rowOffset + k][lane] = (uint16_t)(shape->rows[k] << column);
+}
+
+void BoardBatch_GetRows(const BoardBatch* batch, int lane, uint16_t rows[BOARD_ROWS])
+{
+    for (int row = 0; row < BOARD_ROWS; row++)
+        rows[row] = batch->board[row][lane];
+}
+
+BatchLanes BoardBatch_Fits(const BoardBatch* batch)
+{
+    return (BatchLanes)~(kernels()->overlap(batch, 0) | batch->outside);
+}
+
+BatchLanes BoardBatch_StepDown(BoardBatch* batch, BatchLanes lanes)
+{
+    const BatchKernels* kernel = kernels();
+    BatchLanes blocked = batch->outside | kernel->overlap(batch, 1);
+    for (int lane = 0; lane < BATCH_LANES; lane++) {
+        if (batch->block[BOARD_ROWS - 1][lane] != 0)
+            blocked |= (BatchLanes)(1u << lane);
+    }
+
+    const BatchLanes moved = lanes & (BatchLanes)~blocked;
+    if (moved != 0)
+        kernel->shiftDown(batch, moved);
+    return moved;
+}
+
+void BoardBatch_Lock(BoardBatch* batch, BatchLanes lanes)
+{
+    // Branch-free, so the compiler vectorizes it for any target
+    uint16_t masks[BATCH_LANES];
+    for (int lane = 0; lane < BATCH_LANES; lane++)
+        masks[lane] = (uint16_t)-(int)((lanes >> lane) & 1);
+    for (int row = 0; row < BOARD_ROWS; row++) {
+        for (int lane = 0; lane < BATCH_LANES; lane++) {
+            batch->board[row][lane] |= batch->block[row][lane] & masks[lane];
+            batch->block[row][lane] &= (uint16_t)~masks[lane];
+        }
+    }
+}
+
+BatchLanes BoardBatch_FullRows(const BoardBatch* batch, BatchLanes full[BOARD_ROWS])
+{
+    return kernels()->fullRows(batch, full);
+}
+
+uint8_t BoardBatch_ClearFullRows(BoardBatch* batch, int lane)
+{
+    int target = BOARD_ROWS - 1;
+    for (int row = BOARD_ROWS - 1; row >= 0; row--) {
+        const uint16_t mask = batch->board[row][lane];
+        if (mask != BOARD_ROW_FULL)
+            batch->board[target--][lane] = mask;
+    }
+
+    const uint8_t completed = (uint8_t)(target + 1);
+    for (; target >= 0; target--)
+        batch->board[target][lane] = 0;
+    return completed;
+}
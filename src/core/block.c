@@ -0,0 +1,67 @@
+#include <assert.h>
+
+#include "tetris_core.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void Block_GetCellPositions(const Block* block, Position* positions, size_t* count)
+{
+    *count = NUM_BLOCK_CELLS;
+    for (int i = 0; i < NUM_BLOCK_CELLS; i++) {
+        positions[i].row = BLOCK_LAYOUTS[block->id - 1][block->rotationState][i].row + block->rowOffset;
+        positions[i].column = BLOCK_LAYOUTS[block->id - 1][block->rotationState][i].column + block->columnOffset;
+    }
+}
+
+void Block_Move(Block* block, Position position)
+{
+    block->rowOffset += position.row;
+    block->columnOffset += position.column;
+}
+
+void Block_Rotate(Block* block)
+{
+    block->rotationState++;
+    if (block->rotationState >= block->numRotations)
+        block->rotationState = 0;
+}
+
+void Block_UndoRotation(Block* block)
+{
+    if (block->rotationState == 0)
+        block->rotationState = block->numRotations - 1;
+    else
+        block->rotationState--;
+}
+
+Block Block_Init(BlockType type)
+{
+    Block block;
+    block.rotationState = 0;
+    block.rowOffset = 0;
+    block.columnOffset = 0;
+    block.id = (uint8_t)type;
+    block.numRotations = BLOCK_ROTAIONS[type - 1];
+    Block_Move(&block, BLOCK_OFFSETS[type - 1]);
+
+    return block;
+}
+
+void Block_Copy(Block* dest, const Block* src)
+{
+    assert(dest && src);
+    memcpy(dest, src, sizeof(Block));
+}
+
+uint64_t Block_Zobrist(const Block* block)
+{
+    return Hash_Mix64((2ULL << 32) | (uint64_t)block->id << 24 | (uint64_t)(uint8_t)block->rotationState << 16
+        | (uint64_t)(uint8_t)block->rowOffset << 8 | (uint8_t)block->columnOffset);
+}
+
+Block GetRandomBlock(Randomizer* randomizer)
+{
+    return Block_Init(Randomizer_Next(randomizer));
+}
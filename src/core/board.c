@@ -0,0 +1,275 @@
+#include "tetris_core.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Rebuilds surface from the row masks, visiting rows top-down until every
+// column has found its topmost cell.
+static void updateSurface(Board* board)
+{
+    for (int column = 0; column < board->numCols; column++)
+        board->surface[column] = (int8_t)board->numRows;
+
+    uint32_t pending = BOARD_ROW_FULL;
+    for (int row = 0; row < board->numRows && pending != 0; row++) {
+        uint32_t found = board->rows[row] & pending;
+        pending &= ~found;
+        while (found != 0) {
+            board->surface[Bits_LowestIndex(found)] = (int8_t)row;
+            found &= found - 1;
+        }
+    }
+}
+
+// Zobrist key for row holding mask, zero for an empty row. Keys come from
+// mixing their inputs rather than from a table of random numbers, so they
+// need no setup and are the same in every process; Block_Zobrist mixes its
+// inputs with bit 33 set instead, so the two never share a key.
+static inline uint64_t rowKey(int row, uint16_t mask)
+{
+    const uint64_t key = Hash_Mix64((1ULL << 32) | (uint64_t)row << 16 | mask);
+    return key & -(uint64_t)(mask != 0);
+}
+
+static void blankRow(Board* board, uint8_t row)
+{
+    memset(board->grid[row], 0, sizeof(board->grid[row]));
+    board->rows[row] = 0;
+}
+
+void Board_Init(Board* board)
+{
+    board->numRows = BOARD_ROWS;
+    board->numCols = BOARD_COLUMNS;
+    board->revision = 0;
+    Board_Reset(board);
+}
+
+void Board_Reset(Board* board)
+{
+    memset(board->grid, 0, sizeof(board->grid));
+    memset(board->rows, 0, sizeof(board->rows));
+    memset(board->surface, board->numRows, sizeof(board->surface));
+    board->revision++;
+    board->zobrist = 0;
+}
+
+void Board_Print(const Board* board)
+{
+    for (int row = 0; row < board->numRows; row++) {
+        for (int column = 0; column < board->numCols; column++) {
+            printf("%i ", board->grid[row][column]);
+        }
+        printf("\n");
+    }
+}
+
+uint64_t Board_Hash(const Board* board)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (int row = 0; row < board->numRows; row++) {
+        for (int column = 0; column < board->numCols; column++) {
+            hash ^= board->grid[row][column];
+            hash *= 0x100000001b3ULL;
+        }
+    }
+    return hash;
+}
+
+static uint64_t hashRows(const Board* board, int first)
+{
+    uint64_t zobrist = 0;
+    for (int row = first; row < board->numRows; row++)
+        zobrist ^= rowKey(row, board->rows[row]);
+    return zobrist;
+}
+
+uint64_t Board_Zobrist(const Board* board)
+{
+    return hashRows(board, 0);
+}
+
+bool Board_IsCellOutside(const Board* board, int8_t row, int8_t column)
+{
+    if (row >= 0 && row < board->numRows && column >= 0 && column < board->numCols) {
+        return false;
+    }
+    return true;
+}
+
+bool Board_IsEmpty(const Board* board, uint8_t row, uint8_t column)
+{
+    return (board->rows[row] & (1u << column)) == 0;
+}
+
+void Board_SetCell(Board* board, uint8_t row, uint8_t column, uint8_t value)
+{
+    const uint16_t before = board->rows[row];
+    board->grid[row][column] = value;
+    board->revision++;
+    if (value != 0) {
+        board->rows[row] |= (uint16_t)(1u << column);
+        if (row < board->surface[column])
+            board->surface[column] = (int8_t)row;
+    } else {
+        board->rows[row] &= (uint16_t)~(1u << column);
+        if (row == board->surface[column])
+            updateSurface(board);
+    }
+    board->zobrist ^= rowKey(row, before) ^ rowKey(row, board->rows[row]);
+}
+
+bool Board_IsRowFull(const Board* board, uint8_t row)
+{
+    return board->rows[row] == BOARD_ROW_FULL;
+}
+
+void Board_ClearRow(Board* board, uint8_t row)
+{
+    board->zobrist ^= rowKey(row, board->rows[row]);
+    blankRow(board, row);
+    updateSurface(board);
+    board->revision++;
+}
+
+void Board_MoveRowDown(Board* board, uint8_t row, uint8_t numRows)
+{
+    const int target = row + numRows;
+    board->zobrist ^= rowKey(target, board->rows[target]) ^ rowKey(target, board->rows[row])
+        ^ rowKey(row, board->rows[row]);
+    memcpy(board->grid[target], board->grid[row], sizeof(board->grid[row]));
+    board->rows[target] = board->rows[row];
+    blankRow(board, row);
+    updateSurface(board);
+    board->revision++;
+}
+
+// Compacts the surviving rows towards the bottom in a single pass over the
+// row masks, then blanks the rows left over at the top.
+uint8_t Board_ClearFullRows(Board* board)
+{
+    int8_t target = board->numRows - 1;
+    for (int8_t row = board->numRows - 1; row >= 0; row--) {
+        if (board->rows[row] == BOARD_ROW_FULL)
+            continue;
+        if (target != row) {
+            memcpy(board->grid[target], board->grid[row], sizeof(board->grid[row]));
+            board->rows[target] = board->rows[row];
+        }
+        target--;
+    }
+
+    const uint8_t completed = (uint8_t)(target + 1);
+    if (completed > 0) {
+        for (; target >= 0; target--)
+            blankRow(board, target);
+        updateSurface(board);
+        board->revision++;
+        // Every row above a cleared one moves, and swapping the key of each
+        // costs more than hashing the stack afresh
+        int top = board->numRows;
+        for (int column = 0; column < board->numCols; column++)
+            top = board->surface[column] < top ? board->surface[column] : top;
+        board->zobrist = hashRows(board, top);
+    }
+    return completed;
+}
+
+void Board_PlaceBlock(Board* board, const Block* block)
+{
+    const PieceShape* shape = Block_GetShape(block);
+    const int column = block->columnOffset + shape->left;
+
+    board->revision++;
+    for (int k = shape->top; k <= shape->bottom; k++) {
+        const int row = block->rowOffset + k;
+        assert(row >= 0 && row < board->numRows);
+        uint32_t bits = (uint32_t)shape->rows[k] << column;
+        assert((bits & ~(uint32_t)BOARD_ROW_FULL) == 0);
+
+        const uint16_t before = board->rows[row];
+        board->rows[row] |= (uint16_t)bits;
+        board->zobrist ^= rowKey(row, before) ^ rowKey(row, board->rows[row]);
+        while (bits != 0) {
+            const int cellColumn = Bits_LowestIndex(bits);
+            board->grid[row][cellColumn] = block->id;
+            if (row < board->surface[cellColumn])
+                board->surface[cellColumn] = (int8_t)row;
+            bits &= bits - 1;
+        }
+    }
+}
+
+bool isBlockOutside(const Board* board, const Block* block)
+{
+    assert(board && block);
+    const PieceShape* shape = Block_GetShape(block);
+    const int column = block->columnOffset;
+    const int row = block->rowOffset;
+
+    return row + shape->top < 0 || row + shape->bottom >= board->numRows
+        || column + shape->left < 0 || column + shape->right >= board->numCols;
+}
+
+bool blockFits(const Board* board, const Block* block)
+{
+    const PieceShape* shape = Block_GetShape(block);
+    const int column = block->columnOffset + shape->left;
+    assert(column >= 0);
+
+    uint32_t overlap = 0;
+    for (int k = shape->top; k <= shape->bottom; k++)
+        overlap |= board->rows[block->rowOffset + k] & ((uint32_t)shape->rows[k] << column);
+    return overlap == 0;
+}
+
+// The movement rules, shared by Game and the move generator: a block may
+// occupy a position when it is fully inside the board and overlaps nothing.
+bool Board_CanPlace(const Board* board, const Block* block)
+{
+    return !isBlockOutside(board, block) && blockFits(board, block);
+}
+
+bool Board_TryMove(const Board* board, Block* block, Position delta)
+{
+    Block_Move(block, delta);
+    if (Board_CanPlace(board, block))
+        return true;
+    Block_Move(block, (Position) { (int8_t)-delta.row, (int8_t)-delta.column });
+    return false;
+}
+
+bool Board_TryRotate(const Board* board, Block* block)
+{
+    Block_Rotate(block);
+    if (Board_CanPlace(board, block))
+        return true;
+    Block_UndoRotation(block);
+    return false;
+}
+
+// Row offset at which block comes to rest when dropped straight down. When
+// every column of the block is above the surface, the gap to the surface
+// gives the answer directly; a block tucked under an overhang falls back to
+// stepping down one row at a time.
+int8_t Board_DropRow(const Board* board, const Block* block)
+{
+    const PieceShape* shape = Block_GetShape(block);
+    const int column = block->columnOffset + shape->left;
+    int distance = board->numRows;
+
+    for (int j = 0; j <= shape->right - shape->left; j++) {
+        const int bottom = block->rowOffset + shape->columnBottom[j];
+        const int gap = board->surface[column + j] - 1 - bottom;
+        if (gap < 0) {
+            Block probe = *block;
+            while (Board_CanPlace(board, &probe))
+                probe.rowOffset++;
+            return probe.rowOffset - 1;
+        }
+        if (gap < distance)
+            distance = gap;
+    }
+    return (int8_t)(block->rowOffset + distance);
+}
@@ -0,0 +1,175 @@
+#include "tetris_core.h"
+#include <string.h>
+
+#if BOARD_ROWS > 31
+#error "Feature column masks are 32 bits wide, with one bit for the floor"
+#endif
+#define FULL_COLUMN ((1u << BOARD_ROWS) - 1)
+#define EMPTY_ROW_TRANSITIONS 2
+
+static int rowTransitions(uint32_t row)
+{
+    // Bits 0 and BOARD_COLUMNS + 1 are the walls
+    const uint32_t walled = (row << 1) | 1u | (1u << (BOARD_COLUMNS + 1));
+    return Bits_Count((walled ^ (walled >> 1)) & ((1u << (BOARD_COLUMNS + 1)) - 1));
+}
+
+static ColumnFeatures columnFeatures(uint32_t column)
+{
+    ColumnFeatures features = { 0 };
+    const int top = column ? Bits_LowestIndex(column) : BOARD_ROWS;
+    const uint32_t holes = FULL_COLUMN & ~column & ~((1u << top) - 1);
+    const uint32_t floored = column | (1u << BOARD_ROWS);
+    features.height = (int8_t)(BOARD_ROWS - top);
+    features.holes = (int8_t)Bits_Count(holes);
+    features.transitions = (int8_t)Bits_Count((floored ^ (floored >> 1)) & FULL_COLUMN);
+    if (holes)
+        features.coveredCells = (int8_t)Bits_Count(column & ((1u << Bits_HighestIndex(holes)) - 1));
+    return features;
+}
+
+static int16_t wellDepths(const uint32_t columns[BOARD_COLUMNS], int c)
+{
+    const uint32_t left = c > 0 ? columns[c - 1] : FULL_COLUMN;
+    const uint32_t right = c + 1 < BOARD_COLUMNS ? columns[c + 1] : FULL_COLUMN;
+    const uint32_t open = columns[c] ? (1u << Bits_LowestIndex(columns[c])) - 1 : FULL_COLUMN;
+
+    // Each pass keeps the well cells whose upper neighbour was kept in the
+    // last, so a cell is counted once per cell of well above it
+    int wells = 0;
+    for (uint32_t well = open & left & right; well; well &= well << 1)
+        wells += Bits_Count(well);
+    return (int16_t)wells;
+}
+
+// Adds sign times the shares of columns first..last, and the bumpiness
+// between neighbours among them, to features.
+static void addColumns(const ColumnFeatures perColumn[BOARD_COLUMNS], int first, int last, int sign,
+    BoardFeatures* features)
+{
+    for (int c = first; c <= last; c++) {
+        const ColumnFeatures* column = &perColumn[c];
+        features->height += sign * column->height;
+        features->holes += sign * column->holes;
+        features->wells += sign * column->wells;
+        features->columnTransitions += sign * column->transitions;
+        features->coveredCells += sign * column->coveredCells;
+        if (c < last) {
+            const int step = column->height - perColumn[c + 1].height;
+            features->bumpiness += sign * (step < 0 ? -step : step);
+        }
+    }
+}
+
+// Drops the rows in full from a column mask, moving the ones above down.
+static uint32_t removeRows(uint32_t column, uint32_t full)
+{
+    // Top row first, so the rows still to go keep their index
+    for (; full; full &= full - 1) {
+        const uint32_t above = (1u << Bits_LowestIndex(full)) - 1;
+        column = ((column & above) << 1) | (column & ~((above << 1) | 1));
+    }
+    return column;
+}
+
+// The features after locking block and clearing full rows. columns receives
+// the column masks of that board, and perColumn the shares of the columns in
+// changed[0]..changed[1], the only ones that differ.
+static BoardFeatures place(const FeatureTracker* tracker, const Block* block, uint32_t columns[BOARD_COLUMNS],
+    ColumnFeatures perColumn[BOARD_COLUMNS], int changed[2])
+{
+    const PieceShape* shape = Block_GetShape(block);
+    const int left = block->columnOffset + shape->left;
+    const int right = block->columnOffset + shape->right;
+    BoardFeatures features = tracker->features;
+    memcpy(columns, tracker->columns, sizeof(tracker->columns));
+
+    uint32_t full = 0;
+    for (int k = shape->top; k <= shape->bottom; k++) {
+        const int row = block->rowOffset + k;
+        const uint32_t before = tracker->rows[row];
+        const uint32_t after = before | (uint32_t)shape->rows[k] << left;
+        features.rowTransitions -= rowTransitions(before);
+        if (after == BOARD_ROW_FULL)
+            full |= 1u << row;
+        else
+            features.rowTransitions += rowTransitions(after);
+        for (uint32_t cells = after & ~before; cells; cells &= cells - 1)
+            columns[Bits_LowestIndex(cells)] |= 1u << row;
+    }
+    features.linesCleared = Bits_Count(full);
+
+    if (full == 0) {
+        // Only the block's columns change, and the wells and bumpiness of
+        // their neighbours with them
+        changed[0] = left > 0 ? left - 1 : 0;
+        changed[1] = right + 1 < BOARD_COLUMNS ? right + 1 : BOARD_COLUMNS - 1;
+        for (int c = changed[0]; c <= changed[1]; c++) {
+            perColumn[c] = c >= left && c <= right ? columnFeatures(columns[c]) : tracker->perColumn[c];
+            perColumn[c].wells = wellDepths(columns, c);
+        }
+    } else {
+        // Everything above a cleared row moves, so every column changes
+        features.rowTransitions += features.linesCleared * EMPTY_ROW_TRANSITIONS;
+        changed[0] = 0;
+        changed[1] = BOARD_COLUMNS - 1;
+        for (int c = 0; c < BOARD_COLUMNS; c++)
+            columns[c] = removeRows(columns[c], full);
+        for (int c = 0; c < BOARD_COLUMNS; c++) {
+            perColumn[c] = columnFeatures(columns[c]);
+            perColumn[c].wells = wellDepths(columns, c);
+        }
+    }
+    addColumns(tracker->perColumn, changed[0], changed[1], -1, &features);
+    addColumns(perColumn, changed[0], changed[1], 1, &features);
+    return features;
+}
+
+void FeatureTracker_Init(FeatureTracker* tracker, const Board* board)
+{
+    memset(tracker, 0, sizeof(*tracker));
+    for (int row = 0; row < BOARD_ROWS; row++) {
+        tracker->rows[row] = board->rows[row];
+        tracker->features.rowTransitions += rowTransitions(board->rows[row]);
+        for (uint32_t cells = board->rows[row]; cells; cells &= cells - 1)
+            tracker->columns[Bits_LowestIndex(cells)] |= 1u << row;
+    }
+    for (int c = 0; c < BOARD_COLUMNS; c++) {
+        tracker->perColumn[c] = columnFeatures(tracker->columns[c]);
+        tracker->perColumn[c].wells = wellDepths(tracker->columns, c);
+    }
+    addColumns(tracker->perColumn, 0, BOARD_COLUMNS - 1, 1, &tracker->features);
+}
+
+uint8_t FeatureTracker_Lock(FeatureTracker* tracker, const Block* block)
+{
+    uint32_t columns[BOARD_COLUMNS];
+    ColumnFeatures perColumn[BOARD_COLUMNS];
+    int changed[2];
+    tracker->features = place(tracker, block, columns, perColumn, changed);
+    memcpy(tracker->columns, columns, sizeof(columns));
+    memcpy(&tracker->perColumn[changed[0]], &perColumn[changed[0]],
+        (size_t)(changed[1] - changed[0] + 1) * sizeof(ColumnFeatures));
+
+    const PieceShape* shape = Block_GetShape(block);
+    for (int k = shape->top; k <= shape->bottom; k++)
+        tracker->rows[block->rowOffset + k] |= (uint16_t)(shape->rows[k] << (block->columnOffset + shape->left));
+    if (tracker->features.linesCleared > 0) {
+        int target = BOARD_ROWS - 1;
+        for (int row = BOARD_ROWS - 1; row >= 0; row--) {
+            if (tracker->rows[row] != BOARD_ROW_FULL)
+                tracker->rows[target--] = tracker->rows[row];
+        }
+        for (; target >= 0; target--)
+            tracker->rows[target] = 0;
+    }
+    return (uint8_t)tracker->features.linesCleared;
+}
+
+BoardFeatures FeatureTracker_Evaluate(const FeatureTracker* tracker, const Block* block)
+{
+    uint32_t columns[BOARD_COLUMNS];
+    ColumnFeatures perColumn[BOARD_COLUMNS];
+    int changed[2];
+    return place(tracker, block, columns, perColumn, changed);
+}
@@ -0,0 +1,237 @@
+#include "tetris_core.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+GameConfig Game_DefaultConfig(uint64_t seed)
+{
+    GameConfig config = { .seed = seed, .randomizer = RANDOMIZER_UNIFORM };
+    GameConfig_SetTickRate(&config, GAME_DEFAULT_TICK_RATE);
+    return config;
+}
+
+void GameConfig_SetTickRate(GameConfig* config, uint16_t tickRate)
+{
+    assert(tickRate > 0);
+    const double ticks = GAME_GRAVITY_DELAY * tickRate + 0.5;
+    config->tickRate = tickRate;
+    config->gravityTicks = ticks < 1 ? 1 : (uint16_t)ticks;
+}
+
+// Initializes game in place. Nothing in a Game lives on the heap, so games
+// can be stored by value, copied with memcpy and never need freeing.
+void Game_Init(Game* game, const GameConfig* config)
+{
+    game->config = *config;
+    Randomizer_Init(&game->randomizer, config->randomizer, config->seed);
+    game->gameOver = false;
+    game->score = 0;
+    game->lines = 0;
+    game->pieces = 0;
+    game->events = 0;
+    game->ticks = 0;
+    game->gravityTimer = 0;
+    game->numBlocks = NUM_BLOCKS;
+    Board_Init(&game->board);
+
+    // Spawn initial blocks
+    game->currentBlock = GetRandomBlock(&game->randomizer);
+    game->nextBlock = GetRandomBlock(&game->randomizer);
+    game->shadowBlock = game->currentBlock;
+    game->shadowDirty = true;
+    Game_UpdateShadowBlock(game);
+}
+
+void Game_Apply(Game* game, Action action)
+{
+    switch (action) {
+    case ACTION_MOVE_LEFT:
+        Game_MoveBlockLeft(game);
+        break;
+    case ACTION_MOVE_RIGHT:
+        Game_MoveBlockRight(game);
+        break;
+    case ACTION_ROTATE:
+        Game_RotateBlock(game);
+        break;
+    case ACTION_HARD_DROP:
+        Game_DropBlock(game);
+        break;
+    case ACTION_RESTART:
+        game->gameOver = false;
+        Game_Reset(game);
+        break;
+    case ACTION_NONE:
+    case NUM_ACTIONS:
+        break;
+    }
+}
+
+// One gravity step.
+void Game_Tick(Game* game)
+{
+    Game_MoveBlockDown(game);
+}
+
+// One fixed simulation tick. Gravity is counted in ticks rather than read
+// from a clock, so the same actions on the same ticks always replay the same
+// game, whatever the frame rate was.
+void Game_Advance(Game* game)
+{
+    game->ticks++;
+    if (++game->gravityTimer >= game->config.gravityTicks) {
+        game->gravityTimer = 0;
+        Game_Tick(game);
+    }
+}
+
+uint32_t Game_TakeEvents(Game* game)
+{
+    const uint32_t events = game->events;
+    game->events = 0;
+    return events;
+}
+
+void Game_MoveBlockDown(Game* game)
+{
+    if (!game->gameOver) {
+        if (!Board_TryMove(&game->board, &game->currentBlock, (Position) { 1, 0 }))
+            Game_LockBlock(game, false);
+    }
+}
+
+void Game_DropBlock(Game* game)
+{
+    if (game->gameOver)
+        return;
+
+    Game_UpdateShadowBlock(game);
+    Block_Copy(&game->currentBlock, &game->shadowBlock);
+    Game_LockBlock(game, true);
+}
+
+void Game_MoveBlockRight(Game* game)
+{
+    if (!game->gameOver) {
+        if (Board_TryMove(&game->board, &game->currentBlock, (Position) { 0, 1 }))
+            game->shadowDirty = true;
+    }
+}
+
+void Game_MoveBlockLeft(Game* game)
+{
+    if (!game->gameOver) {
+        if (Board_TryMove(&game->board, &game->currentBlock, (Position) { 0, -1 }))
+            game->shadowDirty = true;
+    }
+}
+
+bool Game_IsBlockOutside(const Game* game)
+{
+    return isBlockOutside(&game->board, &game->currentBlock);
+}
+
+void Game_RotateBlock(Game* game)
+{
+    if (!game->gameOver) {
+        if (Board_TryRotate(&game->board, &game->currentBlock)) {
+            game->shadowDirty = true;
+            game->events |= GAME_EVENT_ROTATE;
+        }
+    }
+}
+
+// Locks the current block at placement, which must come from
+// MoveGen_Placements for the current board and block.
+void Game_ApplyPlacement(Game* game, const Placement* placement)
+{
+    game->currentBlock.rotationState = placement->rotation;
+    game->currentBlock.rowOffset = placement->row;
+    game->currentBlock.columnOffset = placement->column;
+    assert(Board_CanPlace(&game->board, &game->currentBlock));
+    Game_LockBlock(game, true);
+}
+
+void Game_LockBlock(Game* game, bool isHardDrop)
+{
+    Board_PlaceBlock(&game->board, &game->currentBlock);
+    game->shadowDirty = true;
+    game->pieces++;
+
+    game->currentBlock = game->nextBlock;
+    game->currentBlock.rotationState = 0;
+    game->nextBlock = GetRandomBlock(&game->randomizer);
+
+    unsigned int rowsCleared = Board_ClearFullRows(&game->board);
+    if (rowsCleared > 0) {
+        game->events |= GAME_EVENT_LINE_CLEAR;
+        game->lines += rowsCleared;
+        Game_UpdateScore(game, rowsCleared, 0);
+    } else {
+        if (isHardDrop)
+            game->events |= GAME_EVENT_HARD_DROP;
+        else
+            game->events |= GAME_EVENT_SOFT_DROP;
+    }
+
+    // Checked after clearing, since the rows above a clear shift down and
+    // may land where the new block spawns.
+    if (Game_BlockFits(game) == false) {
+        game->gameOver = true;
+        game->events |= GAME_EVENT_GAME_OVER;
+    }
+}
+
+uint64_t Game_Zobrist(const Game* game)
+{
+    return game->board.zobrist ^ Block_Zobrist(&game->currentBlock);
+}
+
+bool Game_BlockFits(const Game* game)
+{
+    return blockFits(&game->board, &game->currentBlock);
+}
+
+// Only recomputes after the block has moved sideways, rotated or been
+// replaced, or the board has changed; gravity never moves the landing row.
+void Game_UpdateShadowBlock(Game* game)
+{
+    if (!game->shadowDirty)
+        return;
+
+    Block_Copy(&game->shadowBlock, &game->currentBlock);
+    game->shadowBlock.rowOffset = Board_DropRow(&game->board, &game->currentBlock);
+    game->shadowDirty = false;
+}
+
+void Game_Save(const Game* game, GameSnapshot* snapshot)
+{
+    memcpy(&snapshot->game, game, sizeof(Game));
+}
+
+void Game_Restore(Game* game, const GameSnapshot* snapshot)
+{
+    memcpy(game, &snapshot->game, sizeof(Game));
+}
+
+void Game_Reset(Game* game)
+{
+    Board_Reset(&game->board);
+
+    // Create new blocks
+    game->currentBlock = GetRandomBlock(&game->randomizer);
+    game->nextBlock = GetRandomBlock(&game->randomizer);
+    game->shadowBlock = game->currentBlock;
+    game->shadowDirty = true;
+    Game_UpdateShadowBlock(game);
+    game->score = 0;
+    game->lines = 0;
+    game->pieces = 0;
+    game->events = 0;
+}
+
+void Game_UpdateScore(Game* game, uint32_t linesCleared, uint32_t moveDownPoints)
+{
+    game->score += moveDownPoints + linesCleared;
+}
@@ -0,0 +1,96 @@
+#include "tetris_core.h"
+#include <assert.h>
+#include <string.h>
+
+static uint16_t secondsToTicks(double seconds, uint16_t tickRate)
+{
+    const double ticks = seconds * tickRate + 0.5;
+    if (ticks < 1)
+        return 0;
+    return ticks > UINT16_MAX ? UINT16_MAX : (uint16_t)ticks;
+}
+
+InputConfig InputConfig_FromSeconds(double das, double arr, uint16_t tickRate)
+{
+    InputConfig config = { secondsToTicks(das, tickRate), secondsToTicks(arr, tickRate) };
+    if (config.das == 0)
+        config.das = 1;
+    return config;
+}
+
+void Input_Init(Input* input, const InputConfig* config)
+{
+    memset(input, 0, sizeof(*input));
+    input->config = *config;
+    input->shift = ACTION_NONE;
+}
+
+bool Input_Push(Input* input, InputEvent event)
+{
+    assert(event.action > ACTION_NONE && event.action < NUM_ACTIONS);
+    if (input->queueCount == INPUT_QUEUE_SIZE)
+        return false;
+
+    input->queue[(input->queueHead + input->queueCount) % INPUT_QUEUE_SIZE] = event;
+    input->queueCount++;
+    return true;
+}
+
+static bool isShift(Action action)
+{
+    return action == ACTION_MOVE_LEFT || action == ACTION_MOVE_RIGHT;
+}
+
+static Action opposite(Action shift)
+{
+    return shift == ACTION_MOVE_LEFT ? ACTION_MOVE_RIGHT : ACTION_MOVE_LEFT;
+}
+
+size_t Input_Tick(Input* input, uint32_t tick, Action* actions)
+{
+    size_t count = 0;
+    bool shiftStarted = false;
+
+    while (input->queueCount > 0 && input->queue[input->queueHead].tick <= tick) {
+        const InputEvent event = input->queue[input->queueHead];
+        input->queueHead = (input->queueHead + 1) % INPUT_QUEUE_SIZE;
+        input->queueCount--;
+
+        if (event.pressed) {
+            // Repeats of a key already held (OS auto repeat) are ignored; the
+            // auto shift below decides when a held key moves again
+            if (input->held[event.action])
+                continue;
+            input->held[event.action] = true;
+            actions[count++] = event.action;
+            if (isShift(event.action)) {
+                input->shift = event.action;
+                input->shiftTicks = 0;
+                shiftStarted = true;
+            }
+        } else {
+            input->held[event.action] = false;
+            // Letting go of the active direction hands auto shift back to
+            // the other one if it is still held, starting over with DAS
+            if (event.action == input->shift) {
+                input->shift = input->held[opposite(event.action)] ? opposite(event.action) : ACTION_NONE;
+                input->shiftTicks = 0;
+                shiftStarted = true;
+            }
+        }
+    }
+
+    if (input->shift != ACTION_NONE && !shiftStarted) {
+        const InputConfig* config = &input->config;
+        input->shiftTicks++;
+        if (input->shiftTicks >= config->das) {
+            if (config->arr == 0) {
+                for (int i = 0; i < BOARD_COLUMNS; i++)
+                    actions[count++] = input->shift;
+            } else if ((input->shiftTicks - config->das) % config->arr == 0) {
+                actions[count++] = input->shift;
+            }
+        }
+    }
+    return count;
+}
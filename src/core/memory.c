@@ -0,0 +1,37 @@
+#include "tetris_core.h"
+#include <stdlib.h>
+
+#ifndef NDEBUG
+static size_t allocationCount = 0;
+#endif
+
+void* Core_Alloc(size_t size)
+{
+#ifndef NDEBUG
+#if defined(__GNUC__) || defined(__clang__)
+    __atomic_fetch_add(&allocationCount, 1, __ATOMIC_RELAXED);
+#else
+    allocationCount++;
+#endif
+#endif
+    return malloc(size);
+}
+
+void Core_Free(void* ptr)
+{
+    free(ptr);
+}
+
+// Total number of Core_Alloc calls so far; always 0 in release builds.
+size_t Core_AllocationCount(void)
+{
+#ifndef NDEBUG
+#if defined(__GNUC__) || defined(__clang__)
+    return __atomic_load_n(&allocationCount, __ATOMIC_RELAXED);
+#else
+    return allocationCount;
+#endif
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,191 @@
+#include "tetris_core.h"
+#include <assert.h>
+#include <string.h>
+
+// The generator works on sets of row offsets instead of single positions:
+// for each rotation and column offset, bit (rowOffset + MOVEGEN_BIAS) of a
+// uint32_t stands for one block position. fits[][] marks the positions
+// Board_CanPlace allows, reach[][] is the visited set of the flood fill,
+// and a down move is a shift by one bit.
+
+#define STATE_ROWS_MASK ((uint32_t)((1ull << MOVEGEN_ROW_STATES) - 1))
+
+typedef uint32_t StateRows[ROTATION_STATES][MOVEGEN_COLUMN_STATES];
+
+// Column-major copy of the board in state-row bit order, with the rows
+// above and below the board marked solid, so a block's collisions with
+// cells and with the floor and ceiling are all found by the same ORs.
+static void buildColumns(const Board* board, uint32_t* columns)
+{
+    const uint32_t walls = ((1u << MOVEGEN_BIAS) - 1) | ~((1u << (board->numRows + MOVEGEN_BIAS)) - 1);
+    for (int column = 0; column < board->numCols; column++)
+        columns[column] = walls;
+
+    for (int row = 0; row < board->numRows; row++) {
+        uint32_t bits = board->rows[row];
+        while (bits != 0) {
+            columns[Bits_LowestIndex(bits)] |= 1u << (row + MOVEGEN_BIAS);
+            bits &= bits - 1;
+        }
+    }
+}
+
+static uint32_t fitsInColumn(const Board* board, const uint32_t* columns, const PieceShape* shape, int columnOffset)
+{
+    const int left = columnOffset + shape->left;
+    if (left < 0 || columnOffset + shape->right >= board->numCols)
+        return 0;
+
+    uint32_t collisions = 0;
+    for (int k = shape->top; k <= shape->bottom; k++) {
+        uint32_t bits = shape->rows[k];
+        while (bits != 0) {
+            collisions |= columns[left + Bits_LowestIndex(bits)] >> k;
+            bits &= bits - 1;
+        }
+    }
+    return ~collisions & STATE_ROWS_MASK;
+}
+
+// Extends every reached position downwards through the positions that fit
+// (a Kogge-Stone occluded fill).
+static uint32_t floodDown(uint32_t reached, uint32_t fits)
+{
+    uint32_t propagate = fits;
+    reached &= fits;
+    reached |= propagate & (reached << 1);
+    propagate &= propagate << 1;
+    reached |= propagate & (reached << 2);
+    propagate &= propagate << 2;
+    reached |= propagate & (reached << 4);
+    propagate &= propagate << 4;
+    reached |= propagate & (reached << 8);
+    propagate &= propagate << 8;
+    reached |= propagate & (reached << 16);
+    return reached;
+}
+
+// Adds the positions of from that fit in (rotation, column) and marks that
+// column for another visit if any of them are new.
+static void spread(StateRows reach, const StateRows fits, uint64_t* pending, int rotation, int column, uint32_t from)
+{
+    if (column < 0 || column >= MOVEGEN_COLUMN_STATES)
+        return;
+    const uint32_t added = from & fits[rotation][column] & ~reach[rotation][column];
+    if (added != 0) {
+        reach[rotation][column] |= added;
+        *pending |= 1ull << (rotation * MOVEGEN_COLUMN_STATES + column);
+    }
+}
+
+static bool sameShape(const PieceShape* a, const PieceShape* b)
+{
+    if (a->bottom - a->top != b->bottom - b->top || a->right - a->left != b->right - b->left)
+        return false;
+    for (int k = 0; k <= a->bottom - a->top; k++) {
+        if (a->rows[a->top + k] != b->rows[b->top + k])
+            return false;
+    }
+    return true;
+}
+
+#ifndef NDEBUG
+static void checkFits(const Board* board, const Block* start, const StateRows fits)
+{
+    Block probe = *start;
+    for (int rotation = 0; rotation < start->numRotations; rotation++) {
+        for (int column = 0; column < MOVEGEN_COLUMN_STATES; column++) {
+            for (int row = 0; row < MOVEGEN_ROW_STATES; row++) {
+                probe.rotationState = (int8_t)rotation;
+                probe.rowOffset = (int8_t)(row - MOVEGEN_BIAS);
+                probe.columnOffset = (int8_t)(column - MOVEGEN_BIAS);
+                assert(((fits[rotation][column] >> row) & 1u) == Board_CanPlace(board, &probe));
+            }
+        }
+    }
+}
+#endif
+
+// Writes every distinct resting placement reachable from start into
+// placements (room for MOVEGEN_MAX_PLACEMENTS) and returns how many there
+// are. Rotations that produce the same cells, such as the two horizontal I
+// rotations, are reported once, under the lowest rotation index.
+size_t MoveGen_Placements(const Board* board, const Block* start, Placement* placements)
+{
+    const int numRotations = start->numRotations;
+    const PieceShape* shapes = PIECE_SHAPES[start->id - 1];
+    uint32_t columns[BOARD_COLUMNS];
+    StateRows fits;
+    StateRows reach;
+    StateRows landed;
+
+    buildColumns(board, columns);
+    memset(fits, 0, sizeof(fits));
+    for (int rotation = 0; rotation < numRotations; rotation++) {
+        for (int column = 0; column < MOVEGEN_COLUMN_STATES; column++)
+            fits[rotation][column] = fitsInColumn(board, columns, &shapes[rotation], column - MOVEGEN_BIAS);
+    }
+#ifndef NDEBUG
+    checkFits(board, start, fits);
+#endif
+
+    // Flood from the start position, revisiting a (rotation, column) pair
+    // whenever a move reaches new positions in it, until nothing changes.
+    memset(reach, 0, sizeof(reach));
+    uint64_t pending = 0;
+    const int startColumn = start->columnOffset + MOVEGEN_BIAS;
+    const uint32_t startRow = 1u << (start->rowOffset + MOVEGEN_BIAS);
+    spread(reach, fits, &pending, start->rotationState, startColumn, startRow);
+    if (pending == 0)
+        return 0;
+
+    while (pending != 0) {
+        const int index = Bits_LowestIndex64(pending);
+        pending &= pending - 1;
+        const int rotation = index / MOVEGEN_COLUMN_STATES;
+        const int column = index % MOVEGEN_COLUMN_STATES;
+        const int next = (rotation + 1) % numRotations;
+
+        const uint32_t reached = floodDown(reach[rotation][column], fits[rotation][column]);
+        reach[rotation][column] = reached;
+        spread(reach, fits, &pending, rotation, column - 1, reached);
+        spread(reach, fits, &pending, rotation, column + 1, reached);
+        if (next != rotation)
+            spread(reach, fits, &pending, next, column, reached);
+    }
+
+    // A position is a resting place when the one below it does not fit.
+    // Fold rotations with identical cells onto the first of them.
+    memset(landed, 0, sizeof(landed));
+    for (int rotation = 0; rotation < numRotations; rotation++) {
+        int canonical = 0;
+        while (!sameShape(&shapes[canonical], &shapes[rotation]))
+            canonical++;
+        const int rowShift = shapes[rotation].top - shapes[canonical].top;
+        const int columnShift = shapes[rotation].left - shapes[canonical].left;
+
+        for (int column = 0; column < MOVEGEN_COLUMN_STATES; column++) {
+            const uint32_t resting = reach[rotation][column] & ~(fits[rotation][column] >> 1);
+            if (resting == 0)
+                continue;
+            const int target = column + columnShift;
+            assert(target >= 0 && target < MOVEGEN_COLUMN_STATES);
+            landed[canonical][target] |= rowShift >= 0 ? resting << rowShift : resting >> -rowShift;
+        }
+    }
+
+    size_t count = 0;
+    for (int rotation = 0; rotation < numRotations; rotation++) {
+        for (int column = 0; column < MOVEGEN_COLUMN_STATES; column++) {
+            uint32_t rows = landed[rotation][column];
+            while (rows != 0) {
+                const int row = Bits_LowestIndex(rows);
+                placements[count++] = (Placement) {
+                    (int8_t)rotation, (int8_t)(row - MOVEGEN_BIAS), (int8_t)(column - MOVEGEN_BIAS)
+                };
+                rows &= rows - 1;
+            }
+        }
+    }
+    return count;
+}
@@ -0,0 +1,300 @@
+#include "tetris_core.h"
+#include <assert.h>
+#include <string.h>
+
+// Weights for the classic four-feature evaluation (aggregate height, lines,
+// holes, bumpiness), tuned for this scoring by genetic search elsewhere.
+#define WEIGHT_HEIGHT -0.510066
+#define WEIGHT_LINES 0.760666
+#define WEIGHT_HOLES -0.35663
+#define WEIGHT_BUMPINESS -0.184483
+#define GAME_OVER_PENALTY -1e9
+
+#define MAX_SHIFT (BOARD_COLUMNS / 2 + 1)
+
+void Policy_Init(Policy* policy, PolicyType type, uint64_t seed, const char* script)
+{
+    policy->type = type;
+    policy->script = script;
+    policy->scriptPosition = 0;
+    policy->depth = POLICY_DEFAULT_DEPTH;
+    policy->table = NULL;
+    policy->tableStats = NULL;
+    policy->tracking = false;
+    Rng_Seed(&policy->rng, seed, 0x5851f42d4c957f2dULL);
+}
+
+// Scripts are strings over L (left), R (right), U (rotate), D (hard drop)
+// and . (gravity tick), replayed cyclically. They must be able to lock a
+// block, or Policy_PlayPiece would never return.
+bool Policy_IsValidScript(const char* script)
+{
+    if (script == NULL || script[0] == '\0')
+        return false;
+    if (strspn(script, "LRUD.") != strlen(script))
+        return false;
+    return strpbrk(script, "D.") != NULL;
+}
+
+static void applyScriptStep(Game* game, char step)
+{
+    switch (step) {
+    case 'L':
+        Game_Apply(game, ACTION_MOVE_LEFT);
+        break;
+    case 'R':
+        Game_Apply(game, ACTION_MOVE_RIGHT);
+        break;
+    case 'U':
+        Game_Apply(game, ACTION_ROTATE);
+        break;
+    case 'D':
+        Game_Apply(game, ACTION_HARD_DROP);
+        break;
+    default:
+        Game_Tick(game);
+        break;
+    }
+}
+
+double Policy_EvaluateBoard(const Board* board, uint32_t linesCleared)
+{
+    int height = 0;
+    int bumpiness = 0;
+    for (int column = 0; column < board->numCols; column++) {
+        const int columnHeight = board->numRows - board->surface[column];
+        height += columnHeight;
+        if (column > 0) {
+            const int step = columnHeight - (board->numRows - board->surface[column - 1]);
+            bumpiness += step < 0 ? -step : step;
+        }
+    }
+
+    // A hole is an empty cell with a filled cell somewhere above it.
+    int holes = 0;
+    uint32_t covered = 0;
+    for (int row = 0; row < board->numRows; row++) {
+        holes += Bits_Count(covered & ~(uint32_t)board->rows[row]);
+        covered |= board->rows[row];
+    }
+
+    return WEIGHT_HEIGHT * height + WEIGHT_LINES * linesCleared + WEIGHT_HOLES * holes + WEIGHT_BUMPINESS * bumpiness;
+}
+
+// Policy_EvaluateBoard from the features of the board instead.
+static double evaluateFeatures(const BoardFeatures* features)
+{
+    return WEIGHT_HEIGHT * features->height + WEIGHT_LINES * features->linesCleared + WEIGHT_HOLES * features->holes
+        + WEIGHT_BUMPINESS * features->bumpiness;
+}
+
+// Tries every reachable placement and keeps the one whose resulting board
+// evaluates best. Boards are evaluated as changes to the current one; a
+// placement is only played out on a copy of the game when it could end it.
+static void playHeuristic(Policy* policy, Game* game)
+{
+    Placement placements[MOVEGEN_MAX_PLACEMENTS];
+    const size_t count = MoveGen_Placements(&game->board, &game->currentBlock, placements);
+    if (count == 0) {
+        Game_DropBlock(game);
+        policy->tracking = false;
+        return;
+    }
+
+    FeatureTracker* tracker = &policy->tracker;
+    if (!policy->tracking || game->board.revision != policy->trackedRevision
+        || game->board.zobrist != policy->trackedZobrist)
+        FeatureTracker_Init(tracker, &game->board);
+    // The next block can only collide with cells in the rows it spawns in,
+    // and clearing rows only moves cells down and out of them
+    const int spawnBottom = game->nextBlock.rowOffset + Block_GetShape(&game->nextBlock)->bottom;
+    int stackTop = BOARD_ROWS;
+    for (int column = 0; column < BOARD_COLUMNS; column++) {
+        if (game->board.surface[column] < stackTop)
+            stackTop = game->board.surface[column];
+    }
+
+    double bestScore = 0;
+    size_t best = 0;
+    for (size_t i = 0; i < count; i++) {
+        Block block = game->currentBlock;
+        block.rotationState = placements[i].rotation;
+        block.rowOffset = placements[i].row;
+        block.columnOffset = placements[i].column;
+        const BoardFeatures features = FeatureTracker_Evaluate(tracker, &block);
+
+        double score = evaluateFeatures(&features);
+        if (stackTop <= spawnBottom || block.rowOffset + Block_GetShape(&block)->top <= spawnBottom) {
+            Game trial = *game;
+            Game_ApplyPlacement(&trial, &placements[i]);
+            if (trial.gameOver)
+                score += GAME_OVER_PENALTY;
+        }
+        if (i == 0 || score > bestScore) {
+            bestScore = score;
+            best = i;
+        }
+    }
+    Block placed = game->currentBlock;
+    placed.rotationState = placements[best].rotation;
+    placed.rowOffset = placements[best].row;
+    placed.columnOffset = placements[best].column;
+    Game_ApplyPlacement(game, &placements[best]);
+    FeatureTracker_Lock(tracker, &placed);
+    policy->trackedRevision = game->board.revision;
+    policy->trackedZobrist = game->board.zobrist;
+    policy->tracking = true;
+}
+
+// The blocks a lookahead searches: the current one, the next one and then
+// as many of the upcoming ones as the depth asks for. keys[level] tells the
+// table how much is left to search below a board at that level, and with
+// which blocks.
+typedef struct
+{
+    Block blocks[POLICY_MAX_DEPTH];
+    uint64_t keys[POLICY_MAX_DEPTH];
+    int depth;
+    TranspositionTable* table;
+    TranspositionStats* stats;
+
+} Search;
+
+static void initSearch(Search* search, const Policy* policy, const Game* game)
+{
+    assert(policy->depth >= 2 && policy->depth <= POLICY_MAX_DEPTH);
+    Randomizer upcoming = game->randomizer;
+    search->depth = policy->depth;
+    search->table = policy->table;
+    search->stats = policy->tableStats;
+    search->blocks[0] = game->currentBlock;
+    // As Game_LockBlock spawns it
+    search->blocks[1] = game->nextBlock;
+    search->blocks[1].rotationState = 0;
+    for (int level = 2; level < search->depth; level++)
+        search->blocks[level] = Block_Init(Randomizer_Next(&upcoming));
+
+    for (int level = 0; level < search->depth; level++) {
+        uint64_t below = (uint64_t)(search->depth - level);
+        for (int k = level + 1; k < search->depth; k++)
+            below = below << 3 | search->blocks[k].id;
+        search->keys[level] = Hash_Mix64((3ULL << 32) ^ below);
+    }
+}
+
+// The best score of placing the blocks from level on down on board: the
+// lines each one clears plus the heuristic score of the last board, or
+// GAME_OVER_PENALTY if the blocks can't all be placed. Boards reached again
+// by another order of placements or another game take their score from the
+// table.
+static double searchBoard(const Search* search, const Board* board, int level)
+{
+    const Block* block = &search->blocks[level];
+    const uint64_t key = board->zobrist ^ Block_Zobrist(block) ^ search->keys[level];
+    uint64_t data;
+    double best = GAME_OVER_PENALTY;
+    if (search->table && TranspositionTable_Probe(search->table, key, &data, search->stats)) {
+        memcpy(&best, &data, sizeof(best));
+        return best;
+    }
+
+    Placement placements[MOVEGEN_MAX_PLACEMENTS];
+    const size_t count = MoveGen_Placements(board, block, placements);
+    FeatureTracker tracker;
+    if (level + 1 == search->depth)
+        FeatureTracker_Init(&tracker, board);
+    for (size_t i = 0; i < count; i++) {
+        Block placed = *block;
+        placed.rotationState = placements[i].rotation;
+        placed.rowOffset = placements[i].row;
+        placed.columnOffset = placements[i].column;
+
+        double score = GAME_OVER_PENALTY;
+        if (level + 1 == search->depth) {
+            const BoardFeatures features = FeatureTracker_Evaluate(&tracker, &placed);
+            score = evaluateFeatures(&features);
+        } else {
+            Board child = *board;
+            Board_PlaceBlock(&child, &placed);
+            const uint8_t lines = Board_ClearFullRows(&child);
+            if (blockFits(&child, &search->blocks[level + 1]))
+                score = WEIGHT_LINES * lines + searchBoard(search, &child, level + 1);
+        }
+        if (i == 0 || score > best)
+            best = score;
+    }
+
+    if (search->table) {
+        memcpy(&data, &best, sizeof(data));
+        TranspositionTable_Store(search->table, key, data, search->stats);
+    }
+    return best;
+}
+
+// Plays the current block where the best sequence of placements through the
+// search depth starts.
+static void playLookahead(const Policy* policy, Game* game)
+{
+    Placement placements[MOVEGEN_MAX_PLACEMENTS];
+    const size_t count = MoveGen_Placements(&game->board, &game->currentBlock, placements);
+    if (count == 0) {
+        Game_DropBlock(game);
+        return;
+    }
+
+    Search search;
+    initSearch(&search, policy, game);
+    double bestScore = 0;
+    size_t best = 0;
+    for (size_t i = 0; i < count; i++) {
+        Block block = game->currentBlock;
+        block.rotationState = placements[i].rotation;
+        block.rowOffset = placements[i].row;
+        block.columnOffset = placements[i].column;
+        Board board = game->board;
+        Board_PlaceBlock(&board, &block);
+        const uint8_t lines = Board_ClearFullRows(&board);
+
+        double score = GAME_OVER_PENALTY;
+        if (blockFits(&board, &search.blocks[1]))
+            score = WEIGHT_LINES * lines + searchBoard(&search, &board, 1);
+        if (i == 0 || score > bestScore) {
+            bestScore = score;
+            best = i;
+        }
+    }
+    Game_ApplyPlacement(game, &placements[best]);
+}
+
+void Policy_PlayPiece(Policy* policy, Game* game)
+{
+    const uint32_t pieces = game->pieces;
+
+    switch (policy->type) {
+    case POLICY_SCRIPTED:
+        assert(Policy_IsValidScript(policy->script));
+        while (game->pieces == pieces && !game->gameOver) {
+            applyScriptStep(game, policy->script[policy->scriptPosition++]);
+            if (policy->script[policy->scriptPosition] == '\0')
+                policy->scriptPosition = 0;
+        }
+        break;
+    case POLICY_HEURISTIC:
+        playHeuristic(policy, game);
+        break;
+    case POLICY_LOOKAHEAD:
+        playLookahead(policy, game);
+        break;
+    case POLICY_RANDOM:
+    case NUM_POLICIES: {
+        const int rotations = (int)Rng_Below(&policy->rng, ROTATION_STATES);
+        const int shift = (int)Rng_Below(&policy->rng, 2 * MAX_SHIFT + 1) - MAX_SHIFT;
+        for (int i = 0; i < rotations; i++)
+            Game_RotateBlock(game);
+        for (int i = 0; i < (shift < 0 ? -shift : shift); i++)
+            Game_Apply(game, shift < 0 ? ACTION_MOVE_LEFT : ACTION_MOVE_RIGHT);
+        Game_DropBlock(game);
+        break;
+    }
+    }
+}
@@ -0,0 +1,71 @@
+#include "tetris_core.h"
+#include <assert.h>
+
+// PCG32 (XSH-RR variant): 64 bits of state, 32-bit output, and independent
+// streams selected by the odd increment.
+#define PCG_MULTIPLIER 6364136223846793005ULL
+
+uint32_t Rng_Next(Rng* rng)
+{
+    const uint64_t oldState = rng->state;
+    rng->state = oldState * PCG_MULTIPLIER + rng->increment;
+    const uint32_t xorShifted = (uint32_t)(((oldState >> 18u) ^ oldState) >> 27u);
+    const uint32_t rotation = (uint32_t)(oldState >> 59u);
+    return (xorShifted >> rotation) | (xorShifted << ((-rotation) & 31u));
+}
+
+void Rng_Seed(Rng* rng, uint64_t seed, uint64_t stream)
+{
+    rng->state = 0;
+    rng->increment = (stream << 1u) | 1u;
+    Rng_Next(rng);
+    rng->state += seed;
+    Rng_Next(rng);
+}
+
+// Unbiased value in [0, bound) by rejecting the short tail of the range.
+uint32_t Rng_Below(Rng* rng, uint32_t bound)
+{
+    assert(bound > 0);
+    const uint32_t threshold = (0u - bound) % bound;
+    for (;;) {
+        const uint32_t value = Rng_Next(rng);
+        if (value >= threshold)
+            return value % bound;
+    }
+}
+
+void Randomizer_Init(Randomizer* randomizer, RandomizerType type, uint64_t seed)
+{
+    randomizer->type = type;
+    randomizer->bagSize = 0;
+    Rng_Seed(&randomizer->rng, seed, seed ^ 0x9e3779b97f4a7c15ULL);
+}
+
+// The bag randomizer deals every block type once, in shuffled order, before
+// refilling, so droughts are at most 12 pieces long.
+static BlockType drawFromBag(Randomizer* randomizer)
+{
+    if (randomizer->bagSize == 0) {
+        for (uint8_t i = 0; i < NUM_BLOCKS; i++)
+            randomizer->bag[i] = i + 1;
+        randomizer->bagSize = NUM_BLOCKS;
+    }
+
+    const uint32_t pick = Rng_Below(&randomizer->rng, randomizer->bagSize);
+    const uint8_t type = randomizer->bag[pick];
+    randomizer->bag[pick] = randomizer->bag[--randomizer->bagSize];
+    return (BlockType)type;
+}
+
+BlockType Randomizer_Next(Randomizer* randomizer)
+{
+    switch (randomizer->type) {
+    case RANDOMIZER_BAG:
+        return drawFromBag(randomizer);
+    case RANDOMIZER_UNIFORM:
+    case NUM_RANDOMIZERS:
+        break;
+    }
+    return (BlockType)(Rng_Below(&randomizer->rng, NUM_BLOCKS) + 1);
+}
@@ -0,0 +1,161 @@
+#include "tetris_core.h"
+#include <assert.h>
+#include <string.h>
+
+static const uint8_t REPLAY_MAGIC[4] = { 'T', 'R', 'P', 'L' };
+
+// Room for the longest varint, so a put never has to check mid-value.
+#define MAX_VARINT_BYTES 10
+
+static void flush(ReplayWriter* writer)
+{
+    if (writer->length > 0 && fwrite(writer->buffer, 1, writer->length, writer->file) != writer->length)
+        writer->failed = true;
+    writer->length = 0;
+}
+
+static void putByte(ReplayWriter* writer, uint8_t value)
+{
+    if (writer->length == REPLAY_BUFFER_SIZE)
+        flush(writer);
+    writer->buffer[writer->length++] = value;
+}
+
+static void putVarint(ReplayWriter* writer, uint64_t value)
+{
+    if (writer->length + MAX_VARINT_BYTES > REPLAY_BUFFER_SIZE)
+        flush(writer);
+    while (value >= 0x80) {
+        writer->buffer[writer->length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    writer->buffer[writer->length++] = (uint8_t)value;
+}
+
+void ReplayWriter_Open(ReplayWriter* writer, FILE* file, const GameConfig* config)
+{
+    writer->file = file;
+    writer->length = 0;
+    writer->lastTick = 0;
+    writer->failed = false;
+
+    for (size_t i = 0; i < sizeof(REPLAY_MAGIC); i++)
+        putByte(writer, REPLAY_MAGIC[i]);
+    putByte(writer, REPLAY_VERSION);
+    putVarint(writer, config->seed);
+    putVarint(writer, (uint64_t)config->randomizer);
+    putVarint(writer, config->tickRate);
+    putVarint(writer, config->gravityTicks);
+}
+
+void ReplayWriter_Action(ReplayWriter* writer, uint32_t tick, Action action)
+{
+    assert(tick >= writer->lastTick);
+    putVarint(writer, ((uint64_t)(tick - writer->lastTick) << REPLAY_ACTION_BITS) | (uint64_t)action);
+    writer->lastTick = tick;
+}
+
+bool ReplayWriter_Close(ReplayWriter* writer, const Game* game)
+{
+    ReplayWriter_Action(writer, game->ticks, ACTION_NONE);
+    putVarint(writer, game->score);
+    putVarint(writer, game->lines);
+    putVarint(writer, game->pieces);
+
+    const uint64_t hash = Board_Hash(&game->board);
+    for (int i = 0; i < 8; i++)
+        putByte(writer, (uint8_t)(hash >> (8 * i)));
+
+    flush(writer);
+    if (fflush(writer->file) != 0)
+        writer->failed = true;
+    return !writer->failed;
+}
+
+typedef struct
+{
+    const uint8_t* data;
+    size_t length;
+    size_t position;
+    bool truncated;
+
+} Reader;
+
+static uint64_t getVarint(Reader* reader)
+{
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (reader->position == reader->length) {
+            reader->truncated = true;
+            return 0;
+        }
+        const uint8_t byte = reader->data[reader->position++];
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return value;
+    }
+    reader->truncated = true;
+    return 0;
+}
+
+ReplayStatus Replay_Play(const uint8_t* data, size_t length, Game* game, ReplaySummary* actual)
+{
+    if (length < sizeof(REPLAY_MAGIC) + 1 || memcmp(data, REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) != 0
+        || data[sizeof(REPLAY_MAGIC)] != REPLAY_VERSION)
+        return REPLAY_CORRUPT;
+
+    Reader reader = { data, length, sizeof(REPLAY_MAGIC) + 1, false };
+    GameConfig config;
+    config.seed = getVarint(&reader);
+    const uint64_t randomizer = getVarint(&reader);
+    const uint64_t tickRate = getVarint(&reader);
+    const uint64_t gravityTicks = getVarint(&reader);
+    if (reader.truncated)
+        return REPLAY_TRUNCATED;
+    if (randomizer >= NUM_RANDOMIZERS || tickRate == 0 || tickRate > UINT16_MAX || gravityTicks == 0
+        || gravityTicks > UINT16_MAX)
+        return REPLAY_CORRUPT;
+    config.randomizer = (RandomizerType)randomizer;
+    config.tickRate = (uint16_t)tickRate;
+    config.gravityTicks = (uint16_t)gravityTicks;
+    Game_Init(game, &config);
+
+    // Same order as a live tick: the actions applied on it, then gravity
+    uint64_t maxTicks = (uint64_t)REPLAY_MAX_SECONDS * config.tickRate;
+    if (maxTicks > UINT32_MAX)
+        maxTicks = UINT32_MAX;
+    uint32_t tick = 0;
+    for (;;) {
+        const uint64_t event = getVarint(&reader);
+        if (reader.truncated)
+            return REPLAY_TRUNCATED;
+        const Action action = (Action)(event & ((1u << REPLAY_ACTION_BITS) - 1));
+        if (action >= NUM_ACTIONS || (event >> REPLAY_ACTION_BITS) > maxTicks - tick)
+            return REPLAY_CORRUPT;
+        tick += (uint32_t)(event >> REPLAY_ACTION_BITS);
+        while (game->ticks < tick)
+            Game_Advance(game);
+        if (action == ACTION_NONE)
+            break;
+        Game_Apply(game, action);
+    }
+
+    ReplaySummary expected;
+    expected.score = (uint32_t)getVarint(&reader);
+    expected.lines = (uint32_t)getVarint(&reader);
+    expected.pieces = (uint32_t)getVarint(&reader);
+    expected.ticks = tick;
+    if (reader.truncated || length - reader.position < 8)
+        return REPLAY_TRUNCATED;
+    expected.boardHash = 0;
+    for (int i = 0; i < 8; i++)
+        expected.boardHash |= (uint64_t)data[reader.position++] << (8 * i);
+
+    const ReplaySummary result = { game->score, game->lines, game->pieces, game->ticks, Board_Hash(&game->board) };
+    if (actual)
+        *actual = result;
+    if (result.score != expected.score || result.lines != expected.lines || result.pieces != expected.pieces
+        || result.boardHash != expected.boardHash)
+        return REPLAY_MISMATCH;
+    return REPLAY_OK;
+}
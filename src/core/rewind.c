@@ -0,0 +1,159 @@
+#include "tetris_core.h"
+#include <assert.h>
+#include <string.h>
+
+// A delta is a sequence of (skip, run) varint pairs, each followed by run
+// bytes to XOR in after skipping skip unchanged bytes. XOR undoes itself, so
+// the same delta steps from either state to the other.
+
+static size_t putVarint(uint8_t* out, size_t value)
+{
+    size_t length = 0;
+    while (value >= 0x80) {
+        out[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = (uint8_t)value;
+    return length;
+}
+
+static size_t getVarint(const uint8_t* in, size_t* position)
+{
+    size_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        const uint8_t byte = in[(*position)++];
+        value |= (size_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return value;
+    }
+}
+
+static size_t encodeDelta(const uint8_t* from, const uint8_t* to, size_t size, uint8_t* out)
+{
+    size_t length = 0;
+    size_t i = 0;
+    while (i < size) {
+        const size_t skipStart = i;
+        // Most of a state is unchanged from one tick to the next
+        while (i + sizeof(uint64_t) <= size && memcmp(from + i, to + i, sizeof(uint64_t)) == 0)
+            i += sizeof(uint64_t);
+        while (i < size && from[i] == to[i])
+            i++;
+        if (i == size)
+            break;
+        const size_t runStart = i;
+        while (i < size && from[i] != to[i])
+            i++;
+
+        length += putVarint(out + length, runStart - skipStart);
+        length += putVarint(out + length, i - runStart);
+        for (size_t k = runStart; k < i; k++)
+            out[length++] = from[k] ^ to[k];
+    }
+    return length;
+}
+
+static void applyDelta(uint8_t* state, const uint8_t* delta, size_t length)
+{
+    size_t position = 0;
+    size_t offset = 0;
+    while (position < length) {
+        offset += getVarint(delta, &position);
+        const size_t run = getVarint(delta, &position);
+        for (size_t k = 0; k < run; k++)
+            state[offset++] ^= delta[position++];
+    }
+}
+
+bool Rewind_Init(Rewind* rewind, size_t maxTicks)
+{
+    assert(maxTicks > 0 && REWIND_MAX_DELTA <= UINT16_MAX);
+    rewind->capacity = maxTicks;
+    rewind->byteCapacity = maxTicks * REWIND_BYTES_PER_TICK + REWIND_MAX_DELTA;
+    rewind->bytes = Core_Alloc(rewind->byteCapacity);
+    rewind->lengths = Core_Alloc(maxTicks * sizeof(uint16_t));
+    if (!rewind->bytes || !rewind->lengths) {
+        Rewind_Free(rewind);
+        return false;
+    }
+    Rewind_Clear(rewind);
+    return true;
+}
+
+void Rewind_Free(Rewind* rewind)
+{
+    Core_Free(rewind->bytes);
+    Core_Free(rewind->lengths);
+    rewind->bytes = NULL;
+    rewind->lengths = NULL;
+}
+
+void Rewind_Clear(Rewind* rewind)
+{
+    rewind->hasLatest = false;
+    rewind->byteStart = 0;
+    rewind->byteCount = 0;
+    rewind->start = 0;
+    rewind->count = 0;
+}
+
+static void dropOldest(Rewind* rewind)
+{
+    const size_t length = rewind->lengths[rewind->start];
+    rewind->byteStart = (rewind->byteStart + length) % rewind->byteCapacity;
+    rewind->byteCount -= length;
+    rewind->start = (rewind->start + 1) % rewind->capacity;
+    rewind->count--;
+}
+
+void Rewind_Push(Rewind* rewind, const Game* game)
+{
+    if (!rewind->hasLatest) {
+        memcpy(&rewind->latest, game, sizeof(Game));
+        rewind->hasLatest = true;
+        return;
+    }
+
+    uint8_t delta[REWIND_MAX_DELTA];
+    const size_t length = encodeDelta((const uint8_t*)&rewind->latest, (const uint8_t*)game, sizeof(Game), delta);
+    while (rewind->count == rewind->capacity || rewind->byteCount + length > rewind->byteCapacity)
+        dropOldest(rewind);
+
+    // Append to the byte ring, wrapping around its end if need be
+    const size_t end = (rewind->byteStart + rewind->byteCount) % rewind->byteCapacity;
+    const size_t head = length < rewind->byteCapacity - end ? length : rewind->byteCapacity - end;
+    memcpy(rewind->bytes + end, delta, head);
+    memcpy(rewind->bytes, delta + head, length - head);
+    rewind->byteCount += length;
+    rewind->lengths[(rewind->start + rewind->count) % rewind->capacity] = (uint16_t)length;
+    rewind->count++;
+
+    memcpy(&rewind->latest, game, sizeof(Game));
+}
+
+size_t Rewind_Length(const Rewind* rewind)
+{
+    return rewind->count;
+}
+
+bool Rewind_Back(Rewind* rewind, size_t ticks, Game* game)
+{
+    if (!rewind->hasLatest || ticks > rewind->count)
+        return false;
+
+    for (size_t i = 0; i < ticks; i++) {
+        // Take the newest delta off the end of both rings
+        rewind->count--;
+        const size_t length = rewind->lengths[(rewind->start + rewind->count) % rewind->capacity];
+        rewind->byteCount -= length;
+        const size_t begin = (rewind->byteStart + rewind->byteCount) % rewind->byteCapacity;
+        const size_t head = length < rewind->byteCapacity - begin ? length : rewind->byteCapacity - begin;
+
+        uint8_t delta[REWIND_MAX_DELTA];
+        memcpy(delta, rewind->bytes + begin, head);
+        memcpy(delta + head, rewind->bytes, length - head);
+        applyDelta((uint8_t*)&rewind->latest, delta, length);
+    }
+    memcpy(game, &rewind->latest, sizeof(Game));
+    return true;
+}
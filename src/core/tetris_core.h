@@ -0,0 +1,940 @@
+#ifndef TETRIS_CORE_H
+#define TETRIS_CORE_H
+
+// Headless rules engine: board, blocks, locking, line clears and scoring.
+// Nothing in here may depend on raylib, so it builds and runs without a
+// window, GPU or audio device.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Position
+typedef struct
+{
+    int8_t row;
+    int8_t column;
+
+} Position;
+
+// Block
+
+typedef enum {
+    Z = 1,
+    S,
+    T,
+    L,
+    J,
+    I,
+    O
+} BlockType;
+
+#define NUM_BLOCKS 7
+#define ROTATION_STATES 4
+#define NUM_BLOCK_CELLS 4
+#define NUM_COLORS 8
+
+typedef struct
+{
+    uint8_t id;
+    int8_t rotationState;
+    int8_t rowOffset;
+    int8_t columnOffset;
+    uint8_t numRotations;
+
+} Block;
+
+void Block_GetCellPositions(const Block* block, Position* positions, size_t* count);
+
+void Block_Move(Block* block, Position position);
+
+void Block_Rotate(Block* block);
+
+void Block_UndoRotation(Block* block);
+
+Block Block_Init(BlockType type);
+
+void Block_Copy(Block* dest, const Block* src);
+
+// Zobrist key of the block's type, rotation and position.
+uint64_t Block_Zobrist(const Block* block);
+
+// Board
+
+#define BOARD_ROWS 20
+#define BOARD_COLUMNS 10
+
+// Occupancy bitboard: bit `column` of rows[row] is set when that cell is
+// filled. It always mirrors the non-zero cells of grid, which keeps the
+// block colors for drawing.
+#if BOARD_COLUMNS > 16
+#error "Board row masks are 16 bits wide"
+#endif
+#define BOARD_ROW_FULL ((uint16_t)((1u << BOARD_COLUMNS) - 1))
+
+// surface[column] is the row of the topmost filled cell in that column, or
+// numRows when the column is empty. It is kept up to date on every change,
+// so dropping a block straight down needs no row-by-row search.
+// revision changes whenever any cell does, so a renderer can keep the locked
+// cells cached until it moves on.
+// zobrist is the XOR of a key for the contents of each row, with an empty
+// row's key being zero. Every change to a row swaps its old key for its new
+// one, so the hash costs a few operations per row a lock or clear touches.
+// It covers occupancy only, not block colors.
+typedef struct
+{
+    uint8_t numRows;
+    uint8_t numCols;
+    uint8_t grid[BOARD_ROWS][BOARD_COLUMNS];
+    uint16_t rows[BOARD_ROWS];
+    int8_t surface[BOARD_COLUMNS];
+    uint32_t revision;
+    uint64_t zobrist;
+
+} Board;
+
+void Board_Init(Board* board);
+
+void Board_Reset(Board* board);
+
+void Board_Print(const Board* board);
+
+// 64-bit FNV-1a over the cell grid; equal boards hash equal on every platform.
+uint64_t Board_Hash(const Board* board);
+
+// zobrist as computed from scratch, for checking the incremental one.
+uint64_t Board_Zobrist(const Board* board);
+
+bool Board_IsCellOutside(const Board* board, int8_t row, int8_t column);
+
+bool Board_IsEmpty(const Board* board, uint8_t row, uint8_t column);
+
+void Board_SetCell(Board* board, uint8_t row, uint8_t column, uint8_t value);
+
+bool Board_IsRowFull(const Board* board, uint8_t row);
+
+void Board_ClearRow(Board* board, uint8_t row);
+
+void Board_MoveRowDown(Board* board, uint8_t row, uint8_t numRows);
+
+uint8_t Board_ClearFullRows(Board* board);
+
+void Board_PlaceBlock(Board* board, const Block* block);
+
+bool isBlockOutside(const Board* board, const Block* block);
+
+bool blockFits(const Board* board, const Block* block);
+
+bool Board_CanPlace(const Board* board, const Block* block);
+
+bool Board_TryMove(const Board* board, Block* block, Position delta);
+
+bool Board_TryRotate(const Board* board, Block* block);
+
+int8_t Board_DropRow(const Board* board, const Block* block);
+
+// Move generation: every distinct resting position a block can reach from
+// its current position with left, right, rotate and down moves.
+
+typedef struct
+{
+    int8_t rotation;
+    int8_t row;
+    int8_t column;
+
+} Placement;
+
+// Offsets are stored biased by MOVEGEN_BIAS so the ones a block can take
+// (its layout box may hang up to three cells off the board) are never
+// negative.
+#define MOVEGEN_BIAS 4
+#define MOVEGEN_ROW_STATES (BOARD_ROWS + MOVEGEN_BIAS)
+#define MOVEGEN_COLUMN_STATES (BOARD_COLUMNS + MOVEGEN_BIAS)
+#if ROTATION_STATES * MOVEGEN_COLUMN_STATES > 64
+#error "Move generator tracks pending columns in a 64-bit mask"
+#endif
+#define MOVEGEN_MAX_PLACEMENTS (ROTATION_STATES * MOVEGEN_COLUMN_STATES * MOVEGEN_ROW_STATES)
+
+size_t MoveGen_Placements(const Board* board, const Block* start, Placement* placements);
+
+// Memory
+
+// Every heap allocation made by the core goes through Core_Alloc. Debug
+// builds count them, so callers can check that play itself never allocates.
+void* Core_Alloc(size_t size);
+
+void Core_Free(void* ptr);
+
+size_t Core_AllocationCount(void);
+
+// Random
+
+// Small, fast and seedable; every Game owns one, so parallel games never
+// share state and a run is reproducible from its seed.
+typedef struct
+{
+    uint64_t state;
+    uint64_t increment;
+
+} Rng;
+
+void Rng_Seed(Rng* rng, uint64_t seed, uint64_t stream);
+
+uint32_t Rng_Next(Rng* rng);
+
+uint32_t Rng_Below(Rng* rng, uint32_t bound);
+
+typedef enum {
+    RANDOMIZER_UNIFORM = 0,
+    RANDOMIZER_BAG,
+    NUM_RANDOMIZERS
+} RandomizerType;
+
+typedef struct
+{
+    Rng rng;
+    RandomizerType type;
+    uint8_t bag[NUM_BLOCKS];
+    uint8_t bagSize;
+
+} Randomizer;
+
+void Randomizer_Init(Randomizer* randomizer, RandomizerType type, uint64_t seed);
+
+BlockType Randomizer_Next(Randomizer* randomizer);
+
+Block GetRandomBlock(Randomizer* randomizer);
+
+// Game
+
+// Everything a player (or a bot) can ask the game to do.
+typedef enum {
+    ACTION_NONE = 0,
+    ACTION_MOVE_LEFT,
+    ACTION_MOVE_RIGHT,
+    ACTION_ROTATE,
+    ACTION_HARD_DROP,
+    ACTION_RESTART,
+    NUM_ACTIONS
+} Action;
+
+// Things that happened since the last Game_TakeEvents call, so a front end
+// can play sounds without the rules knowing about audio.
+typedef enum {
+    GAME_EVENT_ROTATE = 1 << 0,
+    GAME_EVENT_SOFT_DROP = 1 << 1,
+    GAME_EVENT_HARD_DROP = 1 << 2,
+    GAME_EVENT_LINE_CLEAR = 1 << 3,
+    GAME_EVENT_GAME_OVER = 1 << 4,
+} GameEvent;
+
+// The simulation runs in fixed ticks of 1 / tickRate seconds, and gravity
+// moves the block down once every gravityTicks ticks.
+#define GAME_DEFAULT_TICK_RATE 60
+#define GAME_GRAVITY_DELAY 0.3
+
+typedef struct
+{
+    uint64_t seed;
+    RandomizerType randomizer;
+    uint16_t tickRate;
+    uint16_t gravityTicks;
+
+} GameConfig;
+
+typedef struct
+{
+    size_t numBlocks;
+    GameConfig config;
+    Randomizer randomizer;
+    Board board;
+    Block currentBlock;
+    Block nextBlock;
+    Block shadowBlock;
+    uint32_t score;
+    uint32_t lines;
+    uint32_t pieces;
+    uint32_t events;
+    uint32_t ticks;
+    uint16_t gravityTimer;
+    bool gameOver;
+    bool shadowDirty;
+
+} Game;
+
+GameConfig Game_DefaultConfig(uint64_t seed);
+
+// Sets the tick rate in Hz, keeping gravity at GAME_GRAVITY_DELAY seconds.
+void GameConfig_SetTickRate(GameConfig* config, uint16_t tickRate);
+
+void Game_Init(Game* game, const GameConfig* config);
+
+void Game_Apply(Game* game, Action action);
+
+void Game_Tick(Game* game);
+
+void Game_Advance(Game* game);
+
+uint32_t Game_TakeEvents(Game* game);
+
+void Game_MoveBlockDown(Game* game);
+
+void Game_MoveBlockRight(Game* game);
+
+void Game_MoveBlockLeft(Game* game);
+
+void Game_DropBlock(Game* game);
+
+bool Game_IsBlockOutside(const Game* game);
+
+void Game_RotateBlock(Game* game);
+
+void Game_LockBlock(Game* game, bool isHardDrop);
+
+bool Game_BlockFits(const Game* game);
+
+void Game_UpdateShadowBlock(Game* game);
+
+void Game_Reset(Game* game);
+
+void Game_UpdateScore(Game* game, uint32_t linesCleared, uint32_t moveDownPoints);
+
+void Game_ApplyPlacement(Game* game, const Placement* placement);
+
+// Zobrist hash of the board and the current block.
+uint64_t Game_Zobrist(const Game* game);
+
+// Snapshots: a Game holds no pointers, so the full state (board, blocks,
+// score, randomizer and timers) is saved and restored with one memcpy.
+
+typedef struct
+{
+    Game game;
+
+} GameSnapshot;
+
+void Game_Save(const Game* game, GameSnapshot* snapshot);
+
+void Game_Restore(Game* game, const GameSnapshot* snapshot);
+
+// Rewind: the states of the last maxTicks ticks. Only the newest state is
+// kept whole; each older one is stored as the XOR of it and the state after
+// it, run-length encoded, which is a few bytes for most ticks. Stepping back
+// undoes the newest deltas in turn. If a run of large deltas fills the byte
+// budget, the oldest states are dropped early.
+
+#define REWIND_BYTES_PER_TICK 16
+// Worst case for one delta: a skip and a run header around every byte
+#define REWIND_MAX_DELTA (3 * sizeof(Game))
+
+typedef struct
+{
+    Game latest;
+    bool hasLatest;
+    uint8_t* bytes;
+    size_t byteCapacity;
+    size_t byteStart;
+    size_t byteCount;
+    uint16_t* lengths;
+    size_t capacity;
+    size_t start;
+    size_t count;
+
+} Rewind;
+
+// Allocates the buffers up front; pushing and stepping back never allocate.
+bool Rewind_Init(Rewind* rewind, size_t maxTicks);
+
+void Rewind_Free(Rewind* rewind);
+
+void Rewind_Clear(Rewind* rewind);
+
+// Records game as the newest state.
+void Rewind_Push(Rewind* rewind, const Game* game);
+
+// Number of states that can be stepped back to.
+size_t Rewind_Length(const Rewind* rewind);
+
+// Restores into game the state ticks steps before the newest one and
+// forgets everything after it. Returns false, changing nothing, if fewer
+// than ticks states are stored or nothing has been pushed yet.
+bool Rewind_Back(Rewind* rewind, size_t ticks, Game* game);
+
+// Input: turns timestamped presses and releases into actions on simulation
+// ticks. Holding left or right repeats the move: once after das ticks, then
+// every arr ticks (or straight to the wall when arr is 0), counted on the
+// tick clock so frame rate and frame drops do not change the timing.
+
+#define INPUT_QUEUE_SIZE 64
+#define INPUT_MAX_ACTIONS (INPUT_QUEUE_SIZE + BOARD_COLUMNS)
+#define INPUT_DEFAULT_DAS 0.167
+#define INPUT_DEFAULT_ARR 0.033
+
+typedef struct
+{
+    uint32_t tick;
+    Action action;
+    bool pressed;
+
+} InputEvent;
+
+typedef struct
+{
+    uint16_t das;
+    uint16_t arr;
+
+} InputConfig;
+
+typedef struct
+{
+    InputConfig config;
+    InputEvent queue[INPUT_QUEUE_SIZE];
+    size_t queueHead;
+    size_t queueCount;
+    bool held[NUM_ACTIONS];
+    Action shift;
+    uint32_t shiftTicks;
+
+} Input;
+
+// Converts DAS and ARR delays in seconds to ticks at tickRate.
+InputConfig InputConfig_FromSeconds(double das, double arr, uint16_t tickRate);
+
+void Input_Init(Input* input, const InputConfig* config);
+
+// Queues an event for the tick it is stamped with. Events must be pushed in
+// order; returns false if the queue is full.
+bool Input_Push(Input* input, InputEvent event);
+
+// Consumes the events stamped up to tick and runs auto repeat for it, writing
+// the actions to apply, in order, to actions (INPUT_MAX_ACTIONS at most).
+size_t Input_Tick(Input* input, uint32_t tick, Action* actions);
+
+// Replay: a recorded session, enough to re-simulate it exactly. The file is
+// the magic "TRPL", a version byte, then LEB128 varints throughout: seed,
+// randomizer, tickRate and gravityTicks, then one varint per applied action
+// packing (ticks since the previous action << 3 | action). ACTION_NONE ends
+// the stream at the final tick and is followed by the final score, lines and
+// pieces and the 8-byte little-endian Board_Hash, for verification.
+// Replays are at most REPLAY_MAX_SECONDS of game time long; a stream that
+// runs past that is rejected as corrupt rather than simulated.
+
+#define REPLAY_VERSION 1
+#define REPLAY_ACTION_BITS 3
+#define REPLAY_BUFFER_SIZE 4096
+#define REPLAY_MAX_SECONDS (24 * 60 * 60)
+
+#if NUM_ACTIONS > (1 << REPLAY_ACTION_BITS)
+#error "Replay events pack actions into REPLAY_ACTION_BITS bits"
+#endif
+
+// Streams a replay to a file as it is played, in REPLAY_BUFFER_SIZE chunks.
+typedef struct
+{
+    FILE* file;
+    uint8_t buffer[REPLAY_BUFFER_SIZE];
+    size_t length;
+    uint32_t lastTick;
+    bool failed;
+
+} ReplayWriter;
+
+typedef enum {
+    REPLAY_OK,
+    REPLAY_CORRUPT,
+    REPLAY_TRUNCATED,
+    REPLAY_MISMATCH
+} ReplayStatus;
+
+typedef struct
+{
+    uint32_t score;
+    uint32_t lines;
+    uint32_t pieces;
+    uint32_t ticks;
+    uint64_t boardHash;
+
+} ReplaySummary;
+
+// Writes the header for a game started with config; file stays owned by the
+// caller.
+void ReplayWriter_Open(ReplayWriter* writer, FILE* file, const GameConfig* config);
+
+// Records action as applied on tick, which must not go backwards.
+void ReplayWriter_Action(ReplayWriter* writer, uint32_t tick, Action action);
+
+// Ends the stream at game's current tick with its summary and flushes.
+// Returns false if any write failed.
+bool ReplayWriter_Close(ReplayWriter* writer, const Game* game);
+
+// Re-simulates the replay in data into game as fast as possible, and checks
+// the result against the recorded summary. actual, if not NULL, receives the
+// summary of the re-simulated game.
+ReplayStatus Replay_Play(const uint8_t* data, size_t length, Game* game, ReplaySummary* actual);
+
+// Evaluation features: the usual terms a heuristic player scores boards by,
+// kept up to date as blocks lock and rows clear, and computed for a
+// candidate placement as a change to the current ones without building the
+// new board. Walls and the floor count as filled.
+//
+//   height             sum of the column heights
+//   holes              empty cells with a filled cell above them
+//   bumpiness          sum of the height differences of neighbouring columns
+//   wells              empty cells above a column's top with both sides
+//                      filled, a well d deep counting 1 + 2 + ... + d
+//   rowTransitions     filled/empty changes between neighbouring cells of a
+//                      row, so an empty row has 2
+//   columnTransitions  the same between the cells of a column
+//   coveredCells       filled cells with a hole below them
+//   linesCleared       rows cleared by the last lock or the placement
+
+typedef struct
+{
+    int height;
+    int holes;
+    int bumpiness;
+    int wells;
+    int rowTransitions;
+    int columnTransitions;
+    int coveredCells;
+    int linesCleared;
+
+} BoardFeatures;
+
+// One column's share of the features.
+typedef struct
+{
+    int8_t height;
+    int8_t holes;
+    int8_t transitions;
+    int8_t coveredCells;
+    int16_t wells;
+
+} ColumnFeatures;
+
+// The board as row masks and column masks, bit r of columns[c] being set
+// when row r of column c is filled, so every term is a few bit operations
+// per row or column. Each column's share is kept so that a placement only
+// has to work out the columns it changes.
+typedef struct
+{
+    uint16_t rows[BOARD_ROWS];
+    uint32_t columns[BOARD_COLUMNS];
+    ColumnFeatures perColumn[BOARD_COLUMNS];
+    BoardFeatures features;
+
+} FeatureTracker;
+
+// board must have no full rows, as is always the case between locks.
+void FeatureTracker_Init(FeatureTracker* tracker, const Board* board);
+
+// Locks block, which must fit, and clears full rows as Board_PlaceBlock and
+// Board_ClearFullRows do; only the columns and rows it touches are
+// re-evaluated unless rows clear. Returns the number of rows cleared.
+uint8_t FeatureTracker_Lock(FeatureTracker* tracker, const Block* block);
+
+// The features the board would have after locking block, which must fit.
+BoardFeatures FeatureTracker_Evaluate(const FeatureTracker* tracker, const Block* block);
+
+// Transposition table: search results keyed by Zobrist hash, so a search
+// that reaches a position it has already evaluated can reuse the result. The
+// table is a fixed power-of-two number of slots, as many as fit the byte
+// budget, and a store always replaces what its slot held. Threads may share
+// one table without locks: a slot is two words, the key XORed with the data
+// and the data, each read and written atomically, so a slot torn by stores
+// racing on it fails the key check and reads as a miss. Key 0 never hits.
+// Statistics are kept by the caller, one TranspositionStats per thread, so
+// that the only writes to a shared table are the stores themselves.
+
+typedef struct
+{
+    // A collision is a miss on a slot holding another key
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t collisions;
+    uint64_t stores;
+
+} TranspositionStats;
+
+typedef struct
+{
+    uint64_t* slots;
+    size_t mask;
+
+} TranspositionTable;
+
+// Returns false if budgetBytes is too small for one slot or can't be
+// allocated.
+bool TranspositionTable_Init(TranspositionTable* table, size_t budgetBytes);
+
+void TranspositionTable_Free(TranspositionTable* table);
+
+void TranspositionTable_Clear(TranspositionTable* table);
+
+size_t TranspositionTable_Bytes(const TranspositionTable* table);
+
+// stats, if not NULL, counts the probe or store.
+bool TranspositionTable_Probe(const TranspositionTable* table, uint64_t key, uint64_t* data, TranspositionStats* stats);
+
+void TranspositionTable_Store(TranspositionTable* table, uint64_t key, uint64_t data, TranspositionStats* stats);
+
+void TranspositionStats_Add(TranspositionStats* total, const TranspositionStats* stats);
+
+// Policy: automated players for headless runs. Each call to
+// Policy_PlayPiece drives the game until the current block locks.
+// The lookahead policy searches every sequence of placements of the next
+// depth blocks, the current and next ones and then the upcoming ones as the
+// randomizer will deal them, for the one that scores best. With a table set,
+// it skips the boards it has already searched. The heuristic policy keeps
+// the features of the board it left behind and carries them on to the next
+// piece, starting over when the board has changed since, as on a restart.
+
+typedef enum {
+    POLICY_RANDOM = 0,
+    POLICY_SCRIPTED,
+    POLICY_HEURISTIC,
+    POLICY_LOOKAHEAD,
+    NUM_POLICIES
+} PolicyType;
+
+#define POLICY_DEFAULT_DEPTH 2
+#define POLICY_MAX_DEPTH 4
+
+typedef struct
+{
+    PolicyType type;
+    Rng rng;
+    const char* script;
+    size_t scriptPosition;
+    int depth;
+    TranspositionTable* table;
+    // Counts the lookahead's table use when not NULL
+    TranspositionStats* tableStats;
+    // The heuristic policy's board, valid while the game's board still has
+    // trackedRevision and trackedZobrist
+    FeatureTracker tracker;
+    uint32_t trackedRevision;
+    uint64_t trackedZobrist;
+    bool tracking;
+
+} Policy;
+
+void Policy_Init(Policy* policy, PolicyType type, uint64_t seed, const char* script);
+
+bool Policy_IsValidScript(const char* script);
+
+void Policy_PlayPiece(Policy* policy, Game* game);
+
+double Policy_EvaluateBoard(const Board* board, uint32_t linesCleared);
+
+// Batch engine: BATCH_LANES boards, each with one active block, in
+// structure-of-arrays form for simulating many games at once. Row r of every
+// board sits in one array of lanes, and so does row r of every block, kept as
+// full-height board masks; testing fits, moving every block down a row and
+// finding full rows then take a few vector operations per row for all lanes
+// together. SSE2 and AVX2 kernels are picked at run time where the CPU has
+// them, with a scalar fallback, and every kernel agrees bit for bit with
+// Board_CanPlace, Board_PlaceBlock and Board_ClearFullRows. Only occupancy is
+// kept, not block colors.
+
+#define BATCH_LANES 16
+
+// One bit per lane
+typedef uint16_t BatchLanes;
+
+typedef enum {
+    BATCH_KERNEL_SCALAR,
+    BATCH_KERNEL_SSE2,
+    BATCH_KERNEL_AVX2,
+    NUM_BATCH_KERNELS
+} BatchKernel;
+
+typedef struct
+{
+    uint16_t board[BOARD_ROWS][BATCH_LANES];
+    uint16_t block[BOARD_ROWS][BATCH_LANES];
+    // Lanes whose block reaches outside the board, and so can't be placed
+    BatchLanes outside;
+
+} BoardBatch;
+
+// The fastest kernel this CPU supports is used unless another is forced.
+BatchKernel BoardBatch_Kernel(void);
+
+bool BoardBatch_IsKernelSupported(BatchKernel kernel);
+
+// Returns false, changing nothing, if the CPU lacks the kernel.
+bool BoardBatch_UseKernel(BatchKernel kernel);
+
+// Empty boards and no blocks.
+void BoardBatch_Init(BoardBatch* batch);
+
+void BoardBatch_SetBoard(BoardBatch* batch, int lane, const Board* board);
+
+void BoardBatch_SetBlock(BoardBatch* batch, int lane, const Block* block);
+
+void BoardBatch_GetRows(const BoardBatch* batch, int lane, uint16_t rows[BOARD_ROWS]);
+
+// Lanes whose block could be placed where it is.
+BatchLanes BoardBatch_Fits(const BoardBatch* batch);
+
+// Moves the blocks of the given lanes down a row where they fit there, and
+// returns the lanes that moved.
+BatchLanes BoardBatch_StepDown(BoardBatch* batch, BatchLanes lanes);
+
+// Adds the blocks of the given lanes to their boards and removes them.
+void BoardBatch_Lock(BoardBatch* batch, BatchLanes lanes);
+
+// full[row] receives the lanes in which that row is full; returns the lanes
+// with any full row.
+BatchLanes BoardBatch_FullRows(const BoardBatch* batch, BatchLanes full[BOARD_ROWS]);
+
+// Board_ClearFullRows on one lane; returns the number of rows cleared.
+uint8_t BoardBatch_ClearFullRows(BoardBatch* batch, int lane);
+
+// Cell layouts, as (row, column) pairs inside each block's 4x4 bounding
+// box. Both BLOCK_LAYOUTS and the PIECE_SHAPES masks below are expanded from
+// these at compile time, so they cannot drift apart.
+#define Z_LAYOUT_0 0, 0, 0, 1, 1, 1, 1, 2
+#define Z_LAYOUT_1 0, 2, 1, 1, 1, 2, 2, 1
+#define Z_LAYOUT_2 1, 0, 1, 1, 2, 1, 2, 2
+#define Z_LAYOUT_3 0, 1, 1, 0, 1, 1, 2, 0
+#define S_LAYOUT_0 0, 1, 0, 2, 1, 0, 1, 1
+#define S_LAYOUT_1 0, 1, 1, 1, 1, 2, 2, 2
+#define S_LAYOUT_2 1, 1, 1, 2, 2, 0, 2, 1
+#define S_LAYOUT_3 0, 0, 1, 0, 1, 1, 2, 1
+#define T_LAYOUT_0 0, 1, 1, 0, 1, 1, 1, 2
+#define T_LAYOUT_1 0, 1, 1, 1, 1, 2, 2, 1
+#define T_LAYOUT_2 1, 0, 1, 1, 1, 2, 2, 1
+#define T_LAYOUT_3 0, 1, 1, 0, 1, 1, 2, 1
+#define L_LAYOUT_0 0, 2, 1, 0, 1, 1, 1, 2
+#define L_LAYOUT_1 0, 1, 1, 1, 2, 1, 2, 2
+#define L_LAYOUT_2 1, 0, 1, 1, 1, 2, 2, 0
+#define L_LAYOUT_3 0, 0, 0, 1, 1, 1, 2, 1
+#define J_LAYOUT_0 0, 0, 1, 0, 1, 1, 1, 2
+#define J_LAYOUT_1 0, 1, 0, 2, 1, 1, 2, 1
+#define J_LAYOUT_2 1, 0, 1, 1, 1, 2, 2, 2
+#define J_LAYOUT_3 0, 1, 1, 1, 2, 0, 2, 1
+#define I_LAYOUT_0 1, 0, 1, 1, 1, 2, 1, 3
+#define I_LAYOUT_1 0, 2, 1, 2, 2, 2, 3, 2
+#define I_LAYOUT_2 2, 0, 2, 1, 2, 2, 2, 3
+#define I_LAYOUT_3 0, 1, 1, 1, 2, 1, 3, 1
+#define O_LAYOUT_0 0, 0, 0, 1, 1, 0, 1, 1
+
+#define LAYOUT_APPLY(macro, ...) macro(__VA_ARGS__)
+#define LAYOUT_CELLS(r0, c0, r1, c1, r2, c2, r3, c3) { { r0, c0 }, { r1, c1 }, { r2, c2 }, { r3, c3 } }
+
+static const Position BLOCK_LAYOUTS[NUM_BLOCKS][ROTATION_STATES][NUM_BLOCK_CELLS] = {
+    { // Z
+        LAYOUT_APPLY(LAYOUT_CELLS, Z_LAYOUT_0),
+        LAYOUT_APPLY(LAYOUT_CELLS, Z_LAYOUT_1),
+        LAYOUT_APPLY(LAYOUT_CELLS, Z_LAYOUT_2),
+        LAYOUT_APPLY(LAYOUT_CELLS, Z_LAYOUT_3),
+    },
+    { // S
+        LAYOUT_APPLY(LAYOUT_CELLS, S_LAYOUT_0),
+        LAYOUT_APPLY(LAYOUT_CELLS, S_LAYOUT_1),
+        LAYOUT_APPLY(LAYOUT_CELLS, S_LAYOUT_2),
+        LAYOUT_APPLY(LAYOUT_CELLS, S_LAYOUT_3),
+    },
+    { // T
+        LAYOUT_APPLY(LAYOUT_CELLS, T_LAYOUT_0),
+        LAYOUT_APPLY(LAYOUT_CELLS, T_LAYOUT_1),
+        LAYOUT_APPLY(LAYOUT_CELLS, T_LAYOUT_2),
+        LAYOUT_APPLY(LAYOUT_CELLS, T_LAYOUT_3),
+    },
+    { // L
+        LAYOUT_APPLY(LAYOUT_CELLS, L_LAYOUT_0),
+        LAYOUT_APPLY(LAYOUT_CELLS, L_LAYOUT_1),
+        LAYOUT_APPLY(LAYOUT_CELLS, L_LAYOUT_2),
+        LAYOUT_APPLY(LAYOUT_CELLS, L_LAYOUT_3),
+    },
+    { // J
+        LAYOUT_APPLY(LAYOUT_CELLS, J_LAYOUT_0),
+        LAYOUT_APPLY(LAYOUT_CELLS, J_LAYOUT_1),
+        LAYOUT_APPLY(LAYOUT_CELLS, J_LAYOUT_2),
+        LAYOUT_APPLY(LAYOUT_CELLS, J_LAYOUT_3),
+    },
+    { // I
+        LAYOUT_APPLY(LAYOUT_CELLS, I_LAYOUT_0),
+        LAYOUT_APPLY(LAYOUT_CELLS, I_LAYOUT_1),
+        LAYOUT_APPLY(LAYOUT_CELLS, I_LAYOUT_2),
+        LAYOUT_APPLY(LAYOUT_CELLS, I_LAYOUT_3),
+    },
+    { // O
+        LAYOUT_APPLY(LAYOUT_CELLS, O_LAYOUT_0),
+    },
+};
+
+// Precomputed piece masks. rows[k] is the occupancy of layout row k with
+// bit 0 being the leftmost occupied column (left), so a block whose layout
+// box sits at columnOffset covers board bits rows[k] << (columnOffset + left).
+// columnBottom[j] is the lowest layout row used in column left + j.
+typedef struct
+{
+    uint16_t rows[NUM_BLOCK_CELLS];
+    int8_t columnBottom[NUM_BLOCK_CELLS];
+    int8_t top;
+    int8_t bottom;
+    int8_t left;
+    int8_t right;
+
+} PieceShape;
+
+#define LAYOUT_MIN2(a, b) ((a) < (b) ? (a) : (b))
+#define LAYOUT_MAX2(a, b) ((a) > (b) ? (a) : (b))
+#define LAYOUT_MIN4(a, b, c, d) LAYOUT_MIN2(LAYOUT_MIN2(a, b), LAYOUT_MIN2(c, d))
+#define LAYOUT_MAX4(a, b, c, d) LAYOUT_MAX2(LAYOUT_MAX2(a, b), LAYOUT_MAX2(c, d))
+#define LAYOUT_CELL_BIT(r, c, row, left) ((r) == (row) ? 1u << ((c) - (left)) : 0u)
+#define LAYOUT_ROW_MASK(row, left, r0, c0, r1, c1, r2, c2, r3, c3) \
+    (uint16_t)(LAYOUT_CELL_BIT(r0, c0, row, left) | LAYOUT_CELL_BIT(r1, c1, row, left) | LAYOUT_CELL_BIT(r2, c2, row, left) | LAYOUT_CELL_BIT(r3, c3, row, left))
+#define LAYOUT_CELL_ROW(r, c, column) ((c) == (column) ? (r) : -1)
+#define LAYOUT_COLUMN_BOTTOM(column, r0, c0, r1, c1, r2, c2, r3, c3) \
+    LAYOUT_MAX4(LAYOUT_CELL_ROW(r0, c0, column), LAYOUT_CELL_ROW(r1, c1, column), LAYOUT_CELL_ROW(r2, c2, column), LAYOUT_CELL_ROW(r3, c3, column))
+#define LAYOUT_SHAPE(r0, c0, r1, c1, r2, c2, r3, c3)                                                 \
+    {                                                                                              \
+        {                                                                                          \
+            LAYOUT_ROW_MASK(0, LAYOUT_MIN4(c0, c1, c2, c3), r0, c0, r1, c1, r2, c2, r3, c3),       \
+            LAYOUT_ROW_MASK(1, LAYOUT_MIN4(c0, c1, c2, c3), r0, c0, r1, c1, r2, c2, r3, c3),       \
+            LAYOUT_ROW_MASK(2, LAYOUT_MIN4(c0, c1, c2, c3), r0, c0, r1, c1, r2, c2, r3, c3),       \
+            LAYOUT_ROW_MASK(3, LAYOUT_MIN4(c0, c1, c2, c3), r0, c0, r1, c1, r2, c2, r3, c3),       \
+        },                                                                                         \
+        {                                                                                          \
+            LAYOUT_COLUMN_BOTTOM(LAYOUT_MIN4(c0, c1, c2, c3) + 0, r0, c0, r1, c1, r2, c2, r3, c3), \
+            LAYOUT_COLUMN_BOTTOM(LAYOUT_MIN4(c0, c1, c2, c3) + 1, r0, c0, r1, c1, r2, c2, r3, c3), \
+            LAYOUT_COLUMN_BOTTOM(LAYOUT_MIN4(c0, c1, c2, c3) + 2, r0, c0, r1, c1, r2, c2, r3, c3), \
+            LAYOUT_COLUMN_BOTTOM(LAYOUT_MIN4(c0, c1, c2, c3) + 3, r0, c0, r1, c1, r2, c2, r3, c3), \
+        },                                                                                         \
+        LAYOUT_MIN4(r0, r1, r2, r3), LAYOUT_MAX4(r0, r1, r2, r3),                                  \
+        LAYOUT_MIN4(c0, c1, c2, c3), LAYOUT_MAX4(c0, c1, c2, c3)                                   \
+    }
+
+static const PieceShape PIECE_SHAPES[NUM_BLOCKS][ROTATION_STATES] = {
+    { // Z
+        LAYOUT_APPLY(LAYOUT_SHAPE, Z_LAYOUT_0),
+        LAYOUT_APPLY(LAYOUT_SHAPE, Z_LAYOUT_1),
+        LAYOUT_APPLY(LAYOUT_SHAPE, Z_LAYOUT_2),
+        LAYOUT_APPLY(LAYOUT_SHAPE, Z_LAYOUT_3),
+    },
+    { // S
+        LAYOUT_APPLY(LAYOUT_SHAPE, S_LAYOUT_0),
+        LAYOUT_APPLY(LAYOUT_SHAPE, S_LAYOUT_1),
+        LAYOUT_APPLY(LAYOUT_SHAPE, S_LAYOUT_2),
+        LAYOUT_APPLY(LAYOUT_SHAPE, S_LAYOUT_3),
+    },
+    { // T
+        LAYOUT_APPLY(LAYOUT_SHAPE, T_LAYOUT_0),
+        LAYOUT_APPLY(LAYOUT_SHAPE, T_LAYOUT_1),
+        LAYOUT_APPLY(LAYOUT_SHAPE, T_LAYOUT_2),
+        LAYOUT_APPLY(LAYOUT_SHAPE, T_LAYOUT_3),
+    },
+    { // L
+        LAYOUT_APPLY(LAYOUT_SHAPE, L_LAYOUT_0),
+        LAYOUT_APPLY(LAYOUT_SHAPE, L_LAYOUT_1),
+        LAYOUT_APPLY(LAYOUT_SHAPE, L_LAYOUT_2),
+        LAYOUT_APPLY(LAYOUT_SHAPE, L_LAYOUT_3),
+    },
+    { // J
+        LAYOUT_APPLY(LAYOUT_SHAPE, J_LAYOUT_0),
+        LAYOUT_APPLY(LAYOUT_SHAPE, J_LAYOUT_1),
+        LAYOUT_APPLY(LAYOUT_SHAPE, J_LAYOUT_2),
+        LAYOUT_APPLY(LAYOUT_SHAPE, J_LAYOUT_3),
+    },
+    { // I
+        LAYOUT_APPLY(LAYOUT_SHAPE, I_LAYOUT_0),
+        LAYOUT_APPLY(LAYOUT_SHAPE, I_LAYOUT_1),
+        LAYOUT_APPLY(LAYOUT_SHAPE, I_LAYOUT_2),
+        LAYOUT_APPLY(LAYOUT_SHAPE, I_LAYOUT_3),
+    },
+    { // O
+        LAYOUT_APPLY(LAYOUT_SHAPE, O_LAYOUT_0),
+    },
+};
+
+static const Position BLOCK_OFFSETS[NUM_BLOCKS] = {
+    { 0, 3 }, // Z
+    { 0, 3 }, // S
+    { 0, 3 }, // T
+    { 0, 3 }, // L
+    { 0, 3 }, // J
+    { -1, 3 }, // I
+    { 0, 4 }, // O
+};
+
+static const uint8_t BLOCK_ROTAIONS[NUM_BLOCKS] = {
+    4, 4, 4, 4, 4, 4, 1
+};
+
+static inline const PieceShape* Block_GetShape(const Block* block)
+{
+    return &PIECE_SHAPES[block->id - 1][block->rotationState];
+}
+
+static inline int Bits_Count(uint32_t mask)
+{
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__POPCNT__)
+    return __builtin_popcount(mask);
+#else
+    // Without a popcount instruction the builtin is a libgcc call, which
+    // costs more than this
+    mask = mask - ((mask >> 1) & 0x55555555u);
+    mask = (mask & 0x33333333u) + ((mask >> 2) & 0x33333333u);
+    return (int)((((mask + (mask >> 4)) & 0x0f0f0f0fu) * 0x01010101u) >> 24);
+#endif
+}
+
+static inline int Bits_LowestIndex64(uint64_t mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(mask);
+#else
+    int index = 0;
+    while ((mask & 1u) == 0) {
+        mask >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+// Index of the lowest set bit; mask must be non-zero.
+static inline int Bits_LowestIndex(uint32_t mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(mask);
+#else
+    int index = 0;
+    while ((mask & 1u) == 0) {
+        mask >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+// Index of the highest set bit; mask must be non-zero.
+static inline int Bits_HighestIndex(uint32_t mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 31 - __builtin_clz(mask);
+#else
+    int index = 31;
+    while ((mask & 0x80000000u) == 0) {
+        mask <<= 1;
+        index--;
+    }
+    return index;
+#endif
+}
+
+// SplitMix64's finalizer: a bijection whose every output bit depends on
+// every input bit, for turning small indices into well spread keys.
+static inline uint64_t Hash_Mix64(uint64_t value)
+{
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+#endif // TETRIS_CORE_H
@@ -0,0 +1,83 @@
+#include "tetris_core.h"
+#include <string.h>
+
+// Slot i is slots[2 * i] = key ^ data and slots[2 * i + 1] = data. Relaxed
+// atomics are enough: a reader that sees one word of one store and the other
+// of another gets a key that matches neither, barring a 64-bit coincidence.
+#if defined(__GNUC__) || defined(__clang__)
+#define LOAD(word) __atomic_load_n(&(word), __ATOMIC_RELAXED)
+#define STORE(word, value) __atomic_store_n(&(word), (value), __ATOMIC_RELAXED)
+#else
+#define LOAD(word) (word)
+#define STORE(word, value) ((word) = (value))
+#endif
+
+#define SLOT_BYTES (2 * sizeof(uint64_t))
+
+bool TranspositionTable_Init(TranspositionTable* table, size_t budgetBytes)
+{
+    memset(table, 0, sizeof(*table));
+    if (budgetBytes < SLOT_BYTES)
+        return false;
+
+    size_t numSlots = 1;
+    while (numSlots <= budgetBytes / SLOT_BYTES / 2)
+        numSlots *= 2;
+    table->slots = Core_Alloc(numSlots * SLOT_BYTES);
+    if (table->slots == NULL)
+        return false;
+    table->mask = numSlots - 1;
+    TranspositionTable_Clear(table);
+    return true;
+}
+
+void TranspositionTable_Free(TranspositionTable* table)
+{
+    Core_Free(table->slots);
+    memset(table, 0, sizeof(*table));
+}
+
+void TranspositionTable_Clear(TranspositionTable* table)
+{
+    memset(table->slots, 0, TranspositionTable_Bytes(table));
+}
+
+size_t TranspositionTable_Bytes(const TranspositionTable* table)
+{
+    return table->slots ? (table->mask + 1) * SLOT_BYTES : 0;
+}
+
+bool TranspositionTable_Probe(const TranspositionTable* table, uint64_t key, uint64_t* data, TranspositionStats* stats)
+{
+    const uint64_t* slot = &table->slots[2 * (key & table->mask)];
+    const uint64_t check = LOAD(slot[0]);
+    const uint64_t value = LOAD(slot[1]);
+    if ((check ^ value) == key && key != 0) {
+        if (stats)
+            stats->hits++;
+        *data = value;
+        return true;
+    }
+    if (stats) {
+        stats->misses++;
+        stats->collisions += (check | value) != 0;
+    }
+    return false;
+}
+
+void TranspositionTable_Store(TranspositionTable* table, uint64_t key, uint64_t data, TranspositionStats* stats)
+{
+    uint64_t* slot = &table->slots[2 * (key & table->mask)];
+    STORE(slot[0], key ^ data);
+    STORE(slot[1], data);
+    if (stats)
+        stats->stores++;
+}
+
+void TranspositionStats_Add(TranspositionStats* total, const TranspositionStats* stats)
+{
+    total->hits += stats->hits;
+    total->misses += stats->misses;
+    total->collisions += stats->collisions;
+    total->stores += stats->stores;
+}
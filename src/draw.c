@@ -0,0 +1,75 @@
+#include "tetris.h"
+
+void Block_Draw(const Block* block, int offsetX, int offsetY, Texture2D tileSpriteSheet, float opacity)
+{
+    Position positions[NUM_BLOCK_CELLS];
+    size_t count;
+    Block_GetCellPositions(block, positions, &count);
+
+    for (size_t i = 0; i < count; i++) {
+        DrawTexturePro(
+            tileSpriteSheet,
+            (Rectangle) { (block->id - 1) * SPRITE_SIZE, 0, SPRITE_SIZE, SPRITE_SIZE },
+            (Rectangle) { positions[i].column * CELL_SIZE + offsetX, positions[i].row * CELL_SIZE + offsetY, CELL_SIZE, CELL_SIZE },
+            (Vector2) { 0, 0 }, 0, Fade(WHITE, opacity));
+    }
+}
+
+void Board_Draw(const Board* board, int offsetX, int offsetY, Texture2D tileSpriteSheet)
+{
+    DrawRectangle(
+        offsetX,
+        offsetY,
+        (BOARD_CELL_SIZE * BOARD_COLUMNS),
+        BOARD_ROWS * BOARD_CELL_SIZE,
+        darkGrey);
+
+    for (int row = 0; row < board->numRows; row++) {
+        for (int column = 0; column < board->numCols; column++) {
+            int cellValue = board->grid[row][column];
+            if (cellValue != 0) {
+                DrawTexturePro(tileSpriteSheet,
+                    (Rectangle) { (cellValue - 1) * SPRITE_SIZE, 0, SPRITE_SIZE, SPRITE_SIZE },
+                    (Rectangle) { column * BOARD_CELL_SIZE + offsetX, row * BOARD_CELL_SIZE + offsetY, BOARD_CELL_SIZE,
+                        BOARD_CELL_SIZE },
+                    (Vector2) { 0, 0 }, 0, WHITE);
+            }
+        }
+    }
+}
+
+BoardLayer BoardLayer_Load(void)
+{
+    BoardLayer layer = { 0 };
+    layer.texture = LoadRenderTexture(BOARD_COLUMNS * BOARD_CELL_SIZE, BOARD_ROWS * BOARD_CELL_SIZE);
+    SetTextureFilter(layer.texture.texture, TEXTURE_FILTER_POINT);
+    return layer;
+}
+
+void BoardLayer_Unload(BoardLayer* layer)
+{
+    UnloadRenderTexture(layer->texture);
+    layer->valid = false;
+}
+
+// Must be called outside BeginDrawing/EndDrawing.
+void BoardLayer_Update(BoardLayer* layer, const Board* board, Texture2D tileSpriteSheet)
+{
+    if (layer->valid && layer->revision == board->revision)
+        return;
+
+    BeginTextureMode(layer->texture);
+    ClearBackground(BLANK);
+    Board_Draw(board, 0, 0, tileSpriteSheet);
+    EndTextureMode();
+    layer->revision = board->revision;
+    layer->valid = true;
+}
+
+void BoardLayer_Draw(const BoardLayer* layer, int offsetX, int offsetY)
+{
+    const Texture2D texture = layer->texture.texture;
+    // Render textures are stored bottom-up, hence the negative height
+    DrawTextureRec(texture, (Rectangle) { 0, 0, (float)texture.width, (float)-texture.height },
+        (Vector2) { (float)offsetX, (float)offsetY }, WHITE);
+}
@@ -0,0 +1,80 @@
+#include "tetris.h"
+#include <stdio.h>
+
+// A label above a rounded panel with a number centred in it.
+static void drawCounter(Font font, const char* label, uint32_t value, float top)
+{
+    char valueText[12];
+    snprintf(valueText, sizeof(valueText), "%u", (unsigned)value);
+    const Vector2 labelSize = MeasureTextEx(font, label, FONT_SIZE, FONT_SPACING);
+    const Vector2 valueSize = MeasureTextEx(font, valueText, FONT_SIZE, FONT_SPACING);
+
+    DrawTextEx(font, label, (Vector2) { 320 - HUD_X + (170 - labelSize.x) / 2, top }, FONT_SIZE, FONT_SPACING, WHITE);
+    DrawRectangleRounded((Rectangle) { 320 - HUD_X, top + 40, 170, 60 }, 0.3f, 6, lightBlue);
+    DrawTextEx(font, valueText, (Vector2) { 320 - HUD_X + (170 - valueSize.x) / 2, top + 50 }, FONT_SIZE, FONT_SPACING,
+        WHITE);
+}
+
+static void drawNextBlock(const Game* game, Font font, Texture2D tileSpriteSheet)
+{
+    DrawTextEx(font, "Next", (Vector2) { 370 - HUD_X, 175 }, FONT_SIZE, FONT_SPACING, WHITE);
+    DrawRectangleRounded((Rectangle) { 320 - HUD_X, 215, 170, 180 }, 0.3f, 6, lightBlue);
+
+    switch (game->nextBlock.id) {
+    case T:
+        Block_Draw(&game->nextBlock, 255 - HUD_X, 290, tileSpriteSheet, 1.0);
+        break;
+    case L:
+        Block_Draw(&game->nextBlock, 255 - HUD_X, 280, tileSpriteSheet, 1.0);
+        break;
+    default:
+        Block_Draw(&game->nextBlock, 270 - HUD_X, 270, tileSpriteSheet, 1.0);
+        break;
+    }
+}
+
+Hud Hud_Load(void)
+{
+    Hud hud = { 0 };
+    hud.texture = LoadRenderTexture(HUD_WIDTH, SCREEN_HEIGHT);
+    SetTextureFilter(hud.texture.texture, TEXTURE_FILTER_POINT);
+    return hud;
+}
+
+void Hud_Unload(Hud* hud)
+{
+    UnloadRenderTexture(hud->texture);
+    hud->valid = false;
+}
+
+// Must be called outside BeginDrawing/EndDrawing.
+void Hud_Update(Hud* hud, const Game* game, Font font, Texture2D tileSpriteSheet)
+{
+    if (hud->valid && hud->score == game->score && hud->lines == game->lines
+        && hud->nextBlockId == game->nextBlock.id && hud->gameOver == game->gameOver)
+        return;
+
+    // Opaque background, so text edges are blended once, onto the final colour
+    BeginTextureMode(hud->texture);
+    ClearBackground(darkBlue);
+    drawCounter(font, "Score", game->score, 15);
+    drawNextBlock(game, font, tileSpriteSheet);
+    drawCounter(font, "Lines", game->lines, 410);
+    if (game->gameOver)
+        DrawTextEx(font, "GAME OVER", (Vector2) { 320 - HUD_X, 550 }, FONT_SIZE, FONT_SPACING, WHITE);
+    EndTextureMode();
+
+    hud->score = game->score;
+    hud->lines = game->lines;
+    hud->nextBlockId = game->nextBlock.id;
+    hud->gameOver = game->gameOver;
+    hud->valid = true;
+}
+
+void Hud_Draw(const Hud* hud)
+{
+    const Texture2D texture = hud->texture.texture;
+    // Render textures are stored bottom-up, hence the negative height
+    DrawTextureRec(texture, (Rectangle) { 0, 0, (float)texture.width, (float)-texture.height },
+        (Vector2) { HUD_X, 0 }, WHITE);
+}
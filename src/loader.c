@@ -0,0 +1,127 @@
+#include "tetris.h"
+#include <string.h>
+
+// Bundle names in load order: what is on screen first, then audio, with the
+// music, by far the largest file, last. The music is packed as QOA.
+static const char* ASSET_NAMES[NUM_ASSETS] = {
+    [ASSET_TILES] = "textures/tiles.png",
+    [ASSET_FONT] = "fonts/monogram.ttf",
+    [ASSET_ROTATE_SOUND] = "sounds/rotate.wav",
+    [ASSET_CLEAR_SOUND] = "sounds/clear.wav",
+    [ASSET_MOVE_SOUND] = "sounds/move.wav",
+    [ASSET_HARD_DROP_SOUND] = "sounds/harddrop.wav",
+    [ASSET_SOFT_DROP_SOUND] = "sounds/softdrop.wav",
+    [ASSET_MUSIC] = "sounds/tetris-swing.qoa",
+};
+
+static void decodeAsset(AssetId id, Asset* asset)
+{
+    BundleFile file;
+    if (!Bundle_Find(ASSET_NAMES[id], &file)) {
+        TraceLog(LOG_WARNING, "Asset %s is missing from the bundle", ASSET_NAMES[id]);
+        return;
+    }
+
+    switch (id) {
+    case ASSET_TILES:
+        asset->image = LoadImageFromMemory(file.fileType, file.data, file.size);
+        break;
+    case ASSET_ROTATE_SOUND:
+    case ASSET_CLEAR_SOUND:
+    case ASSET_MOVE_SOUND:
+    case ASSET_HARD_DROP_SOUND:
+    case ASSET_SOFT_DROP_SOUND:
+        asset->wave = LoadWaveFromMemory(file.fileType, file.data, file.size);
+        break;
+    // The font is rasterized on the main thread and the music decoded while
+    // streaming, both straight from the bundle
+    case ASSET_FONT:
+    case ASSET_MUSIC:
+        asset->file = file;
+        break;
+    case NUM_ASSETS:
+        break;
+    }
+}
+
+static void* loadAssets(void* context)
+{
+    AssetLoader* loader = context;
+    for (int id = 0; id < NUM_ASSETS; id++) {
+        // Opening the audio device can take a while too, so it happens here,
+        // once the visual assets are done
+        if (id == ASSET_ROTATE_SOUND) {
+            InitAudioDevice();
+            pthread_mutex_lock(&loader->lock);
+            loader->audioReady = IsAudioDeviceReady();
+            pthread_mutex_unlock(&loader->lock);
+        }
+
+        Asset asset = { 0 };
+        decodeAsset((AssetId)id, &asset);
+
+        pthread_mutex_lock(&loader->lock);
+        loader->assets[id] = asset;
+        loader->decoded[id] = true;
+        loader->numDecoded++;
+        pthread_mutex_unlock(&loader->lock);
+    }
+    return NULL;
+}
+
+void AssetLoader_Start(AssetLoader* loader)
+{
+    memset(loader, 0, sizeof(*loader));
+    pthread_mutex_init(&loader->lock, NULL);
+    loader->threaded = pthread_create(&loader->thread, NULL, loadAssets, loader) == 0;
+    if (!loader->threaded) {
+        TraceLog(LOG_WARNING, "Cannot start the asset loader thread, loading in the foreground");
+        loadAssets(loader);
+    }
+}
+
+bool AssetLoader_Take(AssetLoader* loader, AssetId* id, Asset* asset)
+{
+    bool found = false;
+    pthread_mutex_lock(&loader->lock);
+    for (int i = 0; i < NUM_ASSETS && !found; i++) {
+        if (loader->decoded[i] && !loader->taken[i]) {
+            loader->taken[i] = true;
+            *id = (AssetId)i;
+            *asset = loader->assets[i];
+            found = true;
+        }
+    }
+    pthread_mutex_unlock(&loader->lock);
+    return found;
+}
+
+float AssetLoader_Progress(AssetLoader* loader)
+{
+    pthread_mutex_lock(&loader->lock);
+    const int numDecoded = loader->numDecoded;
+    pthread_mutex_unlock(&loader->lock);
+    return (float)numDecoded / NUM_ASSETS;
+}
+
+bool AssetLoader_IsAudioReady(AssetLoader* loader)
+{
+    pthread_mutex_lock(&loader->lock);
+    const bool audioReady = loader->audioReady;
+    pthread_mutex_unlock(&loader->lock);
+    return audioReady;
+}
+
+void AssetLoader_Finish(AssetLoader* loader)
+{
+    if (loader->threaded)
+        pthread_join(loader->thread, NULL);
+    pthread_mutex_destroy(&loader->lock);
+
+    for (int id = 0; id < NUM_ASSETS; id++) {
+        if (loader->taken[id])
+            continue;
+        UnloadImage(loader->assets[id].image);
+        UnloadWave(loader->assets[id].wave);
+    }
+}
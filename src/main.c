@@ -1,18 +1,69 @@
 #include "tetris.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
-int main(void)
+static void printUsage(const char* program)
 {
+    fprintf(stderr, "usage: %s [--seed N] [--bag] [--tick-rate HZ] [--das MS] [--arr MS]\n"
+        "          [--record FILE] [--profile FILE] [--idle]\n", program);
+}
+
+int main(int argc, char** argv)
+{
+    GameConfig config = Game_DefaultConfig((uint64_t)time(NULL));
+    double das = INPUT_DEFAULT_DAS;
+    double arr = INPUT_DEFAULT_ARR;
+    const char* replayPath = NULL;
+    const char* profilePath = NULL;
+    bool idle = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            config.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--bag") == 0) {
+            config.randomizer = RANDOMIZER_BAG;
+        } else if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc) {
+            const long tickRate = strtol(argv[++i], NULL, 10);
+            if (tickRate < 1 || tickRate > 1000) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            GameConfig_SetTickRate(&config, (uint16_t)tickRate);
+        } else if (strcmp(argv[i], "--das") == 0 && i + 1 < argc) {
+            das = strtod(argv[++i], NULL) / 1000.0;
+        } else if (strcmp(argv[i], "--arr") == 0 && i + 1 < argc) {
+            arr = strtod(argv[++i], NULL) / 1000.0;
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            profilePath = argv[++i];
+        } else if (strcmp(argv[i], "--idle") == 0) {
+            idle = true;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
     SetConfigFlags(FLAG_VSYNC_HINT | FLAG_WINDOW_HIGHDPI);
     InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, SCREEN_TITLE);
     SetTargetFPS(60);
-    Game* game = Game_Init();
+    const InputConfig inputConfig = InputConfig_FromSeconds(das, arr, config.tickRate);
+    App* app = App_Init(&config, &inputConfig);
+    if (replayPath && !App_Record(app, replayPath))
+        TraceLog(LOG_WARNING, "Cannot record replay to %s", replayPath);
+    app->profilePath = profilePath;
 
     while (!WindowShouldClose()) {
-        Game_Update(game);
-        Game_Draw(game);
+        App_Update(app);
+        if (!idle || App_NeedsRedraw(app))
+            App_Draw(app);
+        else
+            App_Wait(app);
     }
 
-    Game_Close(game);
+    App_Close(app);
     CloseWindow();
     return 0;
-}
\ No newline at end of file
+}
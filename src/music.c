@@ -0,0 +1,264 @@
+#include "tetris.h"
+#include <stdlib.h>
+#include <string.h>
+
+// QOA decoding, the inverse of tools/pack.c: each frame holds the predictor
+// state of every channel and then slices of twenty 3-bit residuals
+
+#define QOA_SLICE_LEN 20
+#define QOA_FRAME_LEN (256 * QOA_SLICE_LEN)
+#define QOA_LMS_LEN 4
+#define QOA_MAGIC 0x716f6166u // "qoaf"
+
+static const int QOA_SCALEFACTORS[16] = { 1, 7, 21, 45, 84, 138, 211, 304, 421, 562, 731, 928, 1157, 1419, 1715, 2048 };
+static const int QOA_DEQUANT_STEPS[8] = { 3, -3, 10, -10, 18, -18, 28, -28 }; // in quarters
+
+// The audio callback gets no context pointer, so it plays the one player
+static MusicPlayer* callbackPlayer;
+
+static uint64_t readU64(const unsigned char* bytes)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++)
+        value = (value << 8) | bytes[i];
+    return value;
+}
+
+static int dequantize(int scalefactor, int quantized)
+{
+    // scale factor * step, rounded half away from zero
+    const int quarters = QOA_SCALEFACTORS[scalefactor] * QOA_DEQUANT_STEPS[quantized];
+    return quarters < 0 ? -((-quarters + 2) / 4) : (quarters + 2) / 4;
+}
+
+// Decodes the frame at player->offset into player->frame and moves on to
+// the next one, back to the first after the last. Returns the number of
+// sample frames decoded, or 0 if the data is malformed.
+static uint32_t decodeFrame(MusicPlayer* player)
+{
+    if (player->offset + 8 > player->size)
+        player->offset = 8;
+    const unsigned char* bytes = player->data + player->offset;
+    const uint64_t header = readU64(bytes);
+    const uint32_t channels = (uint32_t)(header >> 56);
+    const uint32_t length = (uint32_t)(header >> 16) & 0xffff;
+    const uint32_t frameSize = (uint32_t)header & 0xffff;
+    const uint32_t numSlices = (length + QOA_SLICE_LEN - 1) / QOA_SLICE_LEN;
+    if (channels != player->channels || length == 0 || length > QOA_FRAME_LEN
+        || frameSize != 8 + 16 * channels + 8 * numSlices * channels || frameSize > player->size - player->offset)
+        return 0;
+
+    int history[MUSIC_MAX_CHANNELS][QOA_LMS_LEN];
+    int weights[MUSIC_MAX_CHANNELS][QOA_LMS_LEN];
+    const unsigned char* position = bytes + 8;
+    for (uint32_t c = 0; c < channels; c++, position += 16) {
+        uint64_t packedHistory = readU64(position);
+        uint64_t packedWeights = readU64(position + 8);
+        for (int i = 0; i < QOA_LMS_LEN; i++) {
+            history[c][i] = (int16_t)(packedHistory >> 48);
+            weights[c][i] = (int16_t)(packedWeights >> 48);
+            packedHistory <<= 16;
+            packedWeights <<= 16;
+        }
+    }
+
+    for (uint32_t start = 0; start < length; start += QOA_SLICE_LEN) {
+        const uint32_t end = start + QOA_SLICE_LEN < length ? start + QOA_SLICE_LEN : length;
+        for (uint32_t c = 0; c < channels; c++, position += 8) {
+            uint64_t slice = readU64(position);
+            const int scalefactor = (int)(slice >> 60);
+            slice <<= 4;
+            for (uint32_t i = start; i < end; i++, slice <<= 3) {
+                int predicted = 0;
+                for (int k = 0; k < QOA_LMS_LEN; k++)
+                    predicted += weights[c][k] * history[c][k];
+                predicted >>= 13;
+
+                const int residual = dequantize(scalefactor, (int)(slice >> 61));
+                int sample = predicted + residual;
+                sample = sample < -32768 ? -32768 : sample > 32767 ? 32767 : sample;
+                player->frame[i * channels + c] = (int16_t)sample;
+
+                const int delta = residual >> 4;
+                for (int k = 0; k < QOA_LMS_LEN; k++)
+                    weights[c][k] += history[c][k] < 0 ? -delta : delta;
+                for (int k = 0; k < QOA_LMS_LEN - 1; k++)
+                    history[c][k] = history[c][k + 1];
+                history[c][QOA_LMS_LEN - 1] = sample;
+            }
+        }
+    }
+
+    player->offset += frameSize;
+    return length;
+}
+
+// The first frame still to be played: those before discardUpTo were
+// buffered before a restart and are skipped.
+static uint32_t liveTail(const MusicPlayer* player)
+{
+    const uint32_t tail = __atomic_load_n(&player->tail, __ATOMIC_ACQUIRE);
+    const uint32_t discardUpTo = __atomic_load_n(&player->discardUpTo, __ATOMIC_RELAXED);
+    return (int32_t)(discardUpTo - tail) > 0 ? discardUpTo : tail;
+}
+
+// Decodes frames into the ring for as long as there is room; returns false
+// if the music cannot be decoded.
+static bool fill(MusicPlayer* player)
+{
+    if (__atomic_load_n(&player->restart, __ATOMIC_ACQUIRE)) {
+        // Whatever is buffered now is from the old position; the callback
+        // drops it and stays silent until it sees the flag cleared. The
+        // stream is stopped, so that room is free to refill right away
+        player->offset = 8;
+        player->pendingFrames = 0;
+        __atomic_store_n(&player->discardUpTo, player->head, __ATOMIC_RELAXED);
+        __atomic_store_n(&player->restart, false, __ATOMIC_RELEASE);
+    }
+
+    for (;;) {
+        if (player->pendingFrames == 0) {
+            player->pendingFrames = decodeFrame(player);
+            if (player->pendingFrames == 0)
+                return false;
+        }
+        if (MUSIC_RING_FRAMES - (player->head - liveTail(player)) < player->pendingFrames)
+            return true;
+
+        for (uint32_t i = 0; i < player->pendingFrames; i++) {
+            const uint32_t slot = (player->head + i) & (MUSIC_RING_FRAMES - 1);
+            memcpy(&player->ring[slot * player->channels], &player->frame[i * player->channels],
+                player->channels * sizeof(int16_t));
+        }
+        __atomic_store_n(&player->head, player->head + player->pendingFrames, __ATOMIC_RELEASE);
+        player->pendingFrames = 0;
+    }
+}
+
+static void* decodeMusic(void* context)
+{
+    MusicPlayer* player = context;
+    while (__atomic_load_n(&player->running, __ATOMIC_ACQUIRE)) {
+        if (!fill(player)) {
+            TraceLog(LOG_WARNING, "MUSIC: Malformed QOA data, stopping the music");
+            break;
+        }
+        // The ring holds about two seconds, so this leaves plenty of slack
+        WaitTime(MUSIC_REFILL_INTERVAL);
+    }
+    return NULL;
+}
+
+// Runs on the audio device's thread: copies out whatever the decoder has
+// buffered and pads a shortfall with silence, counting it as an underrun.
+// The silence while a restart is pending is not an underrun.
+static void playMusic(void* buffer, unsigned int frames)
+{
+    MusicPlayer* player = callbackPlayer;
+    int16_t* out = buffer;
+    uint32_t copied = 0;
+    if (!__atomic_load_n(&player->restart, __ATOMIC_ACQUIRE)) {
+        const uint32_t tail = liveTail(player);
+        const uint32_t available = __atomic_load_n(&player->head, __ATOMIC_ACQUIRE) - tail;
+        copied = available < frames ? available : frames;
+        for (uint32_t i = 0; i < copied; i++) {
+            const uint32_t slot = (tail + i) & (MUSIC_RING_FRAMES - 1);
+            memcpy(&out[i * player->channels], &player->ring[slot * player->channels],
+                player->channels * sizeof(int16_t));
+        }
+        __atomic_store_n(&player->tail, tail + copied, __ATOMIC_RELEASE);
+
+        if (copied < frames) {
+            __atomic_fetch_add(&player->underruns, 1, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&player->silentFrames, frames - copied, __ATOMIC_RELAXED);
+        }
+    }
+    memset(&out[copied * player->channels], 0, (frames - copied) * player->channels * sizeof(int16_t));
+}
+
+bool MusicPlayer_Load(MusicPlayer* player, const BundleFile* file)
+{
+    memset(player, 0, sizeof(*player));
+    if (callbackPlayer || file->size < 16 || readU64(file->data) >> 32 != QOA_MAGIC)
+        return false;
+
+    const uint64_t frameHeader = readU64(file->data + 8);
+    player->data = file->data;
+    player->size = (size_t)file->size;
+    player->offset = 8;
+    player->channels = (uint32_t)(frameHeader >> 56);
+    player->sampleRate = (uint32_t)(frameHeader >> 32) & 0xffffff;
+    if (player->channels < 1 || player->channels > MUSIC_MAX_CHANNELS || player->sampleRate == 0)
+        return false;
+
+    player->ring = malloc(MUSIC_RING_FRAMES * player->channels * sizeof(int16_t));
+    player->frame = malloc(QOA_FRAME_LEN * player->channels * sizeof(int16_t));
+    // Buffer some music up front so that playback can start right away
+    if (!player->ring || !player->frame || !fill(player)) {
+        free(player->ring);
+        free(player->frame);
+        return false;
+    }
+
+    player->stream = LoadAudioStream(player->sampleRate, 16, player->channels);
+    callbackPlayer = player;
+    SetAudioStreamCallback(player->stream, playMusic);
+
+    player->running = true;
+    if (pthread_create(&player->thread, NULL, decodeMusic, player) != 0) {
+        TraceLog(LOG_WARNING, "MUSIC: Cannot start the decoder thread");
+        UnloadAudioStream(player->stream);
+        callbackPlayer = NULL;
+        free(player->ring);
+        free(player->frame);
+        player->ring = NULL;
+        return false;
+    }
+    return true;
+}
+
+void MusicPlayer_Unload(MusicPlayer* player)
+{
+    if (!player->ring)
+        return;
+
+    UnloadAudioStream(player->stream);
+    callbackPlayer = NULL;
+    __atomic_store_n(&player->running, false, __ATOMIC_RELEASE);
+    pthread_join(player->thread, NULL);
+
+    const MusicStats stats = MusicPlayer_Stats(player);
+    TraceLog(LOG_INFO, "MUSIC: %u underruns, %u frames of silence", stats.underruns, stats.silentFrames);
+    free(player->ring);
+    free(player->frame);
+    player->ring = NULL;
+}
+
+void MusicPlayer_Play(MusicPlayer* player)
+{
+    if (player->ring && !player->playing) {
+        PlayAudioStream(player->stream);
+        player->playing = true;
+    }
+}
+
+void MusicPlayer_Stop(MusicPlayer* player)
+{
+    if (player->ring && player->playing) {
+        StopAudioStream(player->stream);
+        player->playing = false;
+        // Starts over from the beginning on the next play
+        __atomic_store_n(&player->restart, true, __ATOMIC_RELEASE);
+    }
+}
+
+MusicStats MusicPlayer_Stats(MusicPlayer* player)
+{
+    MusicStats stats = { 0 };
+    if (player->ring) {
+        stats.underruns = __atomic_load_n(&player->underruns, __ATOMIC_RELAXED);
+        stats.silentFrames = __atomic_load_n(&player->silentFrames, __ATOMIC_RELAXED);
+        stats.bufferedFrames = __atomic_load_n(&player->head, __ATOMIC_RELAXED) - liveTail(player);
+    }
+    return stats;
+}
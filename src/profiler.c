@@ -0,0 +1,132 @@
+#include "tetris.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* PHASE_NAMES[NUM_PHASES + 1] = {
+    [PHASE_ASSETS] = "assets",
+    [PHASE_INPUT] = "input",
+    [PHASE_SIMULATION] = "simulation",
+    [PHASE_AUDIO] = "audio",
+    [PHASE_DRAW] = "draw",
+    [NUM_PHASES] = "frame",
+};
+
+void Profiler_BeginFrame(Profiler* profiler)
+{
+    memset(profiler->current, 0, sizeof(profiler->current));
+    profiler->frameStart = GetTime();
+}
+
+void Profiler_Begin(Profiler* profiler)
+{
+    profiler->phaseStart = GetTime();
+}
+
+void Profiler_End(Profiler* profiler, ProfilerPhase phase)
+{
+    profiler->current[phase] += (float)((GetTime() - profiler->phaseStart) * 1000.0);
+}
+
+void Profiler_EndFrame(Profiler* profiler)
+{
+    profiler->current[NUM_PHASES] = (float)((GetTime() - profiler->frameStart) * 1000.0);
+    memcpy(profiler->samples[profiler->frames % PROFILER_FRAMES], profiler->current, sizeof(profiler->current));
+    profiler->frames++;
+}
+
+static size_t numSamples(const Profiler* profiler)
+{
+    return profiler->frames < PROFILER_FRAMES ? (size_t)profiler->frames : PROFILER_FRAMES;
+}
+
+static int compareFloats(const void* a, const void* b)
+{
+    const float x = *(const float*)a;
+    const float y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+PhaseSummary Profiler_Summarize(const Profiler* profiler, ProfilerPhase phase)
+{
+    PhaseSummary summary = { 0 };
+    const size_t count = numSamples(profiler);
+    if (count == 0)
+        return summary;
+
+    float sorted[PROFILER_FRAMES];
+    for (size_t i = 0; i < count; i++)
+        sorted[i] = profiler->samples[i][phase];
+    qsort(sorted, count, sizeof(float), compareFloats);
+
+    // Nearest rank
+    summary.p50 = sorted[(count + 1) / 2 - 1];
+    summary.p99 = sorted[(count * 99 + 99) / 100 - 1];
+    summary.max = sorted[count - 1];
+    return summary;
+}
+
+void Profiler_Draw(const Profiler* profiler, const MusicStats* music)
+{
+    const int lineHeight = 12;
+    DrawRectangle(0, 0, 250, (NUM_PHASES + 4) * lineHeight, Fade(BLACK, 0.7f));
+    DrawText(TextFormat("%d fps, last %d frames (ms):", GetFPS(), (int)numSamples(profiler)), 5, 4, 10, WHITE);
+    DrawText("p50      p99      max", 100, 4 + lineHeight, 10, WHITE);
+    for (int phase = 0; phase <= NUM_PHASES; phase++) {
+        const PhaseSummary summary = Profiler_Summarize(profiler, (ProfilerPhase)phase);
+        const int y = 4 + (phase + 2) * lineHeight;
+        DrawText(PHASE_NAMES[phase], 5, y, 10, WHITE);
+        DrawText(TextFormat("%6.2f   %6.2f   %6.2f", summary.p50, summary.p99, summary.max), 100, y, 10, WHITE);
+    }
+    DrawText(TextFormat("music underruns %u, %u frames buffered", music->underruns, music->bufferedFrames), 5,
+        4 + (NUM_PHASES + 3) * lineHeight, 10, WHITE);
+}
+
+static bool hasExtension(const char* path, const char* extension)
+{
+    const size_t length = strlen(path);
+    const size_t extensionLength = strlen(extension);
+    return length >= extensionLength && strcmp(path + length - extensionLength, extension) == 0;
+}
+
+bool Profiler_Dump(const Profiler* profiler, const char* path)
+{
+    FILE* file = fopen(path, "w");
+    if (!file)
+        return false;
+
+    const size_t count = numSamples(profiler);
+    const uint64_t first = profiler->frames - count;
+    if (hasExtension(path, ".json")) {
+        fprintf(file, "{\n  \"frames\": %llu,\n  \"summary\": {\n", (unsigned long long)profiler->frames);
+        for (int phase = 0; phase <= NUM_PHASES; phase++) {
+            const PhaseSummary summary = Profiler_Summarize(profiler, (ProfilerPhase)phase);
+            fprintf(file, "    \"%s\": { \"p50_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f }%s\n", PHASE_NAMES[phase],
+                summary.p50, summary.p99, summary.max, phase < NUM_PHASES ? "," : "");
+        }
+        fprintf(file, "  },\n  \"samples\": [\n");
+        for (uint64_t frame = first; frame < profiler->frames; frame++) {
+            const float* sample = profiler->samples[frame % PROFILER_FRAMES];
+            fprintf(file, "    { \"frame\": %llu", (unsigned long long)frame);
+            for (int phase = 0; phase <= NUM_PHASES; phase++)
+                fprintf(file, ", \"%s\": %.4f", PHASE_NAMES[phase], sample[phase]);
+            fprintf(file, " }%s\n", frame + 1 < profiler->frames ? "," : "");
+        }
+        fprintf(file, "  ]\n}\n");
+    } else {
+        fprintf(file, "frame");
+        for (int phase = 0; phase <= NUM_PHASES; phase++)
+            fprintf(file, ",%s_ms", PHASE_NAMES[phase]);
+        fprintf(file, "\n");
+        for (uint64_t frame = first; frame < profiler->frames; frame++) {
+            const float* sample = profiler->samples[frame % PROFILER_FRAMES];
+            fprintf(file, "%llu", (unsigned long long)frame);
+            for (int phase = 0; phase <= NUM_PHASES; phase++)
+                fprintf(file, ",%.4f", sample[phase]);
+            fprintf(file, "\n");
+        }
+    }
+
+    const bool ok = !ferror(file);
+    return fclose(file) == 0 && ok;
+}
@@ -1,336 +1,305 @@
 #ifndef TETRIS_H
 #define TETRIS_H
 
+#include "bundle.h"
+#include "core/tetris_core.h"
+#include <pthread.h>
 #include <raylib.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
-// Position
+// Colors
+static const Color darkGrey = { 26, 31, 40, 255 };
+static const Color lightBlue = { 59, 85, 162, 255 };
+static const Color darkBlue = { 44, 44, 127, 255 };
+static const Color blue = { 13, 64, 216, 255 };
+static const Color orange = { 226, 116, 17, 255 };
+static const Color cyan = { 21, 204, 209, 255 };
+static const Color yellow = { 237, 234, 4, 255 };
+static const Color green = { 47, 230, 23, 255 };
+static const Color purple = { 166, 0, 247, 255 };
+static const Color red = { 232, 18, 18, 255 };
+
+// Drawing
+
+#define CELL_SIZE 30
+#define BOARD_CELL_SIZE 30
+#define BOARD_PADDING 11
+
+void Block_Draw(const Block* block, int offsetX, int offsetY, Texture2D tileSpriteSheet, float opacity);
+
+void Board_Draw(const Board* board, int offsetX, int offsetY, Texture2D tileSpriteSheet);
+
+// The locked cells, rendered off-screen and redrawn only when the board's
+// revision moves on, so a frame costs one quad for them however full the
+// board is.
 typedef struct
 {
-    int8_t row;
-    int8_t column;
+    RenderTexture2D texture;
+    uint32_t revision;
+    bool valid;
 
-} Position;
+} BoardLayer;
 
-// Block
+BoardLayer BoardLayer_Load(void);
 
-typedef enum {
-    Z = 1,
-    S,
-    T,
-    L,
-    J,
-    I,
-    O
-} BlockType;
-
-#define ROTATION_STATES 4
-#define NUM_BLOCK_CELLS 4
-#define NUM_COLORS 8
-#define CELL_SIZE 30
+void BoardLayer_Unload(BoardLayer* layer);
+
+void BoardLayer_Update(BoardLayer* layer, const Board* board, Texture2D tileSpriteSheet);
+
+void BoardLayer_Draw(const BoardLayer* layer, int offsetX, int offsetY);
+
+// HUD: the score, lines and next piece panels right of the board. They are
+// composited into a render texture that is redrawn only when one of the
+// values shown changes.
+
+#define HUD_X (BOARD_PADDING + BOARD_COLUMNS * BOARD_CELL_SIZE)
+#define HUD_WIDTH (SCREEN_WIDTH - HUD_X)
 
 typedef struct
 {
-    uint8_t id;
-    int8_t rotationState;
-    uint8_t rowOffset;
-    uint8_t columnOffset;
-    uint8_t numRotations;
+    RenderTexture2D texture;
+    uint32_t score;
+    uint32_t lines;
+    uint8_t nextBlockId;
+    bool gameOver;
+    bool valid;
 
-} Block;
+} Hud;
 
-void Block_GetCellPositions(const Block* block, Position* positions, size_t* count);
+Hud Hud_Load(void);
 
-void Block_Draw(const Block* block, int offsetX, int offsetY, Texture2D tileSpriteSheet, float opacity);
+void Hud_Unload(Hud* hud);
 
-void Block_Move(Block* block, Position position);
+void Hud_Update(Hud* hud, const Game* game, Font font, Texture2D tileSpriteSheet);
 
-void Block_Rotate(Block* block);
+void Hud_Draw(const Hud* hud);
 
-void Block_UndoRotation(Block* block);
+// Asset loading: a background thread decodes every asset from the bundle and
+// opens the audio device, while the main thread keeps drawing. Whatever
+// needs the GPU or the audio device is finished on the main thread, as each
+// asset is taken from the loader.
 
-Block* Block_Init(BlockType type);
+typedef enum {
+    ASSET_TILES,
+    ASSET_FONT,
+    ASSET_ROTATE_SOUND,
+    ASSET_CLEAR_SOUND,
+    ASSET_MOVE_SOUND,
+    ASSET_HARD_DROP_SOUND,
+    ASSET_SOFT_DROP_SOUND,
+    ASSET_MUSIC,
+    NUM_ASSETS
+} AssetId;
 
-Block* Block_Clone(const Block* src);
+typedef struct
+{
+    Image image;
+    Wave wave;
+    BundleFile file;
 
-void Block_Copy(Block* dest, const Block* src);
+} Asset;
 
-void Block_Free(Block* block);
+typedef struct
+{
+    pthread_t thread;
+    pthread_mutex_t lock;
+    Asset assets[NUM_ASSETS];
+    bool decoded[NUM_ASSETS];
+    bool taken[NUM_ASSETS];
+    int numDecoded;
+    bool audioReady;
+    bool threaded;
 
-Block* GetRandomBlock();
+} AssetLoader;
 
-// Colors
-static const Color darkGrey = { 26, 31, 40, 255 };
-static const Color lightBlue = { 59, 85, 162, 255 };
-static const Color darkBlue = { 44, 44, 127, 255 };
-static const Color blue = { 13, 64, 216, 255 };
-static const Color orange = { 226, 116, 17, 255 };
-static const Color cyan = { 21, 204, 209, 255 };
-static const Color yellow = { 237, 234, 4, 255 };
-static const Color green = { 47, 230, 23, 255 };
-static const Color purple = { 166, 0, 247, 255 };
-static const Color red = { 232, 18, 18, 255 };
+// Starts loading; falls back to loading everything before returning if no
+// thread can be started.
+void AssetLoader_Start(AssetLoader* loader);
 
-// Board
+// Hands over the next decoded asset that has not been taken yet; returns
+// false if there is none right now.
+bool AssetLoader_Take(AssetLoader* loader, AssetId* id, Asset* asset);
 
-#define BOARD_ROWS 20
-#define BOARD_COLUMNS 10
-#define BOARD_CELL_SIZE 30
-#define BOARD_PADDING 11
+// Fraction of assets decoded so far, from 0 to 1.
+float AssetLoader_Progress(AssetLoader* loader);
+
+bool AssetLoader_IsAudioReady(AssetLoader* loader);
+
+// Waits for the loader thread and frees anything never taken.
+void AssetLoader_Finish(AssetLoader* loader);
+
+// Music: a thread decodes the QOA music from the bundle into a lock-free
+// single producer, single consumer ring of sample frames, which the audio
+// device's callback drains. The render loop never refills the stream, so a
+// long frame can't starve it. Only one player can be loaded at a time.
+
+#define MUSIC_MAX_CHANNELS 2
+#define MUSIC_RING_FRAMES 32768 // a power of two
+#define MUSIC_REFILL_INTERVAL 0.05
+
+typedef struct
+{
+    uint32_t underruns;
+    uint32_t silentFrames;
+    uint32_t bufferedFrames;
+
+} MusicStats;
 
 typedef struct
 {
-    uint8_t numRows;
-    uint8_t numCols;
-    uint8_t grid[BOARD_ROWS][BOARD_COLUMNS];
+    AudioStream stream;
+    pthread_t thread;
+    // The decoder's state, touched by its thread only
+    const unsigned char* data;
+    size_t size;
+    size_t offset;
+    int16_t* frame;
+    uint32_t pendingFrames;
+    uint32_t channels;
+    uint32_t sampleRate;
+    // Sample frames ever written (by the decoder) and read (by the
+    // callback); the ring holds those in between
+    int16_t* ring;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t discardUpTo;
+    uint32_t underruns;
+    uint32_t silentFrames;
+    bool restart;
+    bool running;
+    bool playing;
+
+} MusicPlayer;
+
+// Starts decoding a QOA file from the bundle; returns false, leaving a
+// player that ignores every call, if it cannot.
+bool MusicPlayer_Load(MusicPlayer* player, const BundleFile* file);
+
+void MusicPlayer_Unload(MusicPlayer* player);
+
+void MusicPlayer_Play(MusicPlayer* player);
+
+// Stops playback and rewinds to the start.
+void MusicPlayer_Stop(MusicPlayer* player);
+
+MusicStats MusicPlayer_Stats(MusicPlayer* player);
+
+// Profiler: times the phases of every frame on raylib's monotonic clock and
+// keeps the last PROFILER_FRAMES frames in a ring, for p50/p99/max
+// summaries, the F3 overlay and a CSV or JSON dump. Phases may be entered
+// several times a frame; their times add up.
+
+#define PROFILER_FRAMES 1024
 
-} Board;
+typedef enum {
+    PHASE_ASSETS,
+    PHASE_INPUT,
+    PHASE_SIMULATION,
+    PHASE_AUDIO,
+    PHASE_DRAW,
+    NUM_PHASES
+} ProfilerPhase;
 
-Board* Board_Init();
+typedef struct
+{
+    float p50;
+    float p99;
+    float max;
 
-void Board_Free(Board* board);
+} PhaseSummary;
 
-void Board_Reset(Board* board);
+typedef struct
+{
+    // Milliseconds per phase, with the whole frame at NUM_PHASES
+    float samples[PROFILER_FRAMES][NUM_PHASES + 1];
+    float current[NUM_PHASES + 1];
+    uint64_t frames;
+    double frameStart;
+    double phaseStart;
+    bool overlay;
 
-void Board_Print(const Board* board);
+} Profiler;
 
-void Board_Draw(const Board* board, Texture2D tileSpriteSheet);
+void Profiler_BeginFrame(Profiler* profiler);
 
-bool Board_IsCellOutside(const Board* board, int8_t row, int8_t column);
+void Profiler_Begin(Profiler* profiler);
 
-bool Board_IsEmpty(const Board* board, uint8_t row, uint8_t column);
+void Profiler_End(Profiler* profiler, ProfilerPhase phase);
 
-bool Board_IsRowFull(const Board* board, uint8_t row);
+void Profiler_EndFrame(Profiler* profiler);
 
-void Board_ClearRow(Board* board, uint8_t row);
+// Pass NUM_PHASES for the whole frame.
+PhaseSummary Profiler_Summarize(const Profiler* profiler, ProfilerPhase phase);
 
-void Board_MoveRowDown(Board* board, uint8_t row, uint8_t numRows);
+void Profiler_Draw(const Profiler* profiler, const MusicStats* music);
 
-uint8_t Board_ClearFullRows(Board* board);
+// Writes every frame still in the ring, as JSON if path ends in ".json" and
+// as CSV otherwise.
+bool Profiler_Dump(const Profiler* profiler, const char* path);
 
-// Game
-#define NUM_BLOCKS 7
+// App: the raylib front end driving a headless Game
 
 typedef struct
 {
-    Music music;
+    MusicPlayer music;
     Font font;
     Sound rotateSound;
     Sound clearSound;
     Sound moveSound;
     Sound softDropSound;
     Sound hardDropSound;
-    size_t numBlocks;
     Texture2D tileSpriteSheet;
-    Board* board;
-    Block* currentBlock;
-    Block* nextBlock;
-    Block* shadowBlock;
-    uint32_t score;
-    bool gameOver;
+    AssetLoader loader;
+    BoardLayer boardLayer;
+    Hud hud;
+    Game game;
+    double lastTime;
+    double accumulator;
+    Input input;
+    FILE* replayFile;
+    ReplayWriter replay;
+    Rewind rewind;
+    bool rewinding;
+    // A restart is queued for the next tick
+    bool restartQueued;
+    Block previousBlock;
+    uint32_t previousPieces;
+    Profiler profiler;
+    // Where to dump the profile on close, if anywhere
+    const char* profilePath;
+    bool redraw;
+    double lastDrawTime;
+
+} App;
+
+App* App_Init(const GameConfig* config, const InputConfig* inputConfig);
+
+void App_Update(App* app);
+
+void App_Close(App* app);
+
+// Records the session from the current tick on to a replay file at path.
+bool App_Record(App* app, const char* path);
+
+void App_Draw(App* app);
+
+// Idle mode: frames are drawn only when App_NeedsRedraw says something on
+// screen has changed; otherwise App_Wait sleeps until the next tick is due,
+// leaving the last presented frame up. Either one ends the profiled frame,
+// which has no draw time when nothing was drawn.
+bool App_NeedsRedraw(App* app);
+
+void App_Wait(App* app);
+
+void App_HandleInput(App* app);
+
+void App_Step(App* app);
+
+void App_PlayEvents(App* app);
 
-} Game;
-
-Game* Game_Init();
-
-void Game_Update(Game* game);
-
-void Game_Close(Game* game);
-
-void Game_Draw(const Game* game);
-
-void Game_HandleInput(Game* game);
-
-void Game_MoveBlockDown(Game* game);
-
-void Game_MoveBlockRight(Game* game);
-
-void Game_MoveBlockLeft(Game* game);
-
-void Game_DropBlock(Game* game);
-
-bool Game_IsBlockOutside(const Game* game);
-
-void Game_RotateBlock(Game* game);
-
-void Game_LockBlock(Game* game, bool isHardDrop);
-
-bool Game_BlockFits(const Game* game);
-
-void Game_UpdateShadowBlock(Game* game);
-
-void Game_Reset(Game* game);
-
-void Game_UpdateScore(Game* game, uint32_t linesCleared, uint32_t moveDownPoints);
-
-static const Position BLOCK_LAYOUTS[NUM_BLOCKS][ROTATION_STATES][NUM_BLOCK_CELLS] = {
-    { // Z
-        {
-            { 0, 0 },
-            { 0, 1 },
-            { 1, 1 },
-            { 1, 2 },
-        },
-        {
-            { 0, 2 },
-            { 1, 1 },
-            { 1, 2 },
-            { 2, 1 },
-        },
-        {
-            { 1, 0 },
-            { 1, 1 },
-            { 2, 1 },
-            { 2, 2 },
-        },
-        {
-            { 0, 1 },
-            { 1, 0 },
-            { 1, 1 },
-            { 2, 0 },
-        } },
-    { // S
-        {
-            { 0, 1 },
-            { 0, 2 },
-            { 1, 0 },
-            { 1, 1 },
-        },
-        {
-            { 0, 1 },
-            { 1, 1 },
-            { 1, 2 },
-            { 2, 2 },
-        },
-        {
-            { 1, 1 },
-            { 1, 2 },
-            { 2, 0 },
-            { 2, 1 },
-        },
-        {
-            { 0, 0 },
-            { 1, 0 },
-            { 1, 1 },
-            { 2, 1 },
-        } },
-    { // T
-        {
-            { 0, 1 },
-            { 1, 0 },
-            { 1, 1 },
-            { 1, 2 },
-        },
-        {
-            { 0, 1 },
-            { 1, 1 },
-            { 1, 2 },
-            { 2, 1 },
-        },
-        {
-            { 1, 0 },
-            { 1, 1 },
-            { 1, 2 },
-            { 2, 1 },
-        },
-        {
-            { 0, 1 },
-            { 1, 0 },
-            { 1, 1 },
-            { 2, 1 },
-        } },
-    { // L
-        {
-            { 0, 2 },
-            { 1, 0 },
-            { 1, 1 },
-            { 1, 2 } },
-        { { 0, 1 },
-            { 1, 1 },
-            { 2, 1 },
-            { 2, 2 } },
-        { { 1, 0 },
-            { 1, 1 },
-            { 1, 2 },
-            { 2, 0 } },
-        { { 0, 0 },
-            { 0, 1 },
-            { 1, 1 },
-            { 2, 1 } } },
-    { // J
-        {
-            { 0, 0 },
-            { 1, 0 },
-            { 1, 1 },
-            { 1, 2 },
-        },
-        {
-            { 0, 1 },
-            { 0, 2 },
-            { 1, 1 },
-            { 2, 1 },
-        },
-        {
-            { 1, 0 },
-            { 1, 1 },
-            { 1, 2 },
-            { 2, 2 },
-        },
-        {
-            { 0, 1 },
-            { 1, 1 },
-            { 2, 0 },
-            { 2, 1 },
-        } },
-    { // I
-        {
-            { 1, 0 },
-            { 1, 1 },
-            { 1, 2 },
-            { 1, 3 },
-        },
-        {
-            { 0, 2 },
-            { 1, 2 },
-            { 2, 2 },
-            { 3, 2 },
-        },
-        {
-            { 2, 0 },
-            { 2, 1 },
-            { 2, 2 },
-            { 2, 3 },
-        },
-        {
-            { 0, 1 },
-            { 1, 1 },
-            { 2, 1 },
-            { 3, 1 },
-        } },
-    { // O
-        {
-            { 0, 0 },
-            { 0, 1 },
-            { 1, 0 },
-            { 1, 1 },
-        } },
-};
-
-static const Position BLOCK_OFFSETS[NUM_BLOCKS] = {
-    { 0, 3 }, // Z
-    { 0, 3 }, // S
-    { 0, 3 }, // T
-    { 0, 3 }, // L
-    { 0, 3 }, // J
-    { -1, 3 }, // I
-    { 0, 4 }, // O
-};
-
-static const uint8_t BLOCK_ROTAIONS[NUM_BLOCKS] = {
-    4, 4, 4, 4, 4, 4, 1
-};
+void App_PollAssets(App* app);
 
 // Some constants
 
@@ -339,7 +308,11 @@ static const uint8_t BLOCK_ROTAIONS[NUM_BLOCKS] = {
 #define SCREEN_TITLE "Tetris"
 #define FONT_SIZE 38
 #define FONT_SPACING 2
-#define MOVE_DELAY 0.3
+#define FONT_LOAD_SIZE 32
+#define MAX_FRAME_TIME 0.25
+#define REWIND_SECONDS 10
+#define IDLE_REFRESH_INTERVAL 1.0
+#define IDLE_GAME_OVER_WAIT 0.05
 #define SPRITE_SIZE 16
 
 #endif // TETRIS_H
\ No newline at end of file
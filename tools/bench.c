@@ -0,0 +1,1126 @@
+// tetris-bench: perft-style correctness counts for the rules engine, checked
+// against golden values, plus microbenchmarks of the board hot paths.
+
+#include "core/tetris_core.h"
+#include "pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+    SETUP_EMPTY,
+    SETUP_GARBAGE,
+    SETUP_OVERHANGS,
+    SETUP_TETRIS_READY
+} BoardSetup;
+
+typedef struct
+{
+    const char* name;
+    uint64_t seed;
+    RandomizerType randomizer;
+    BoardSetup setup;
+    int depth;
+    uint64_t leaves;
+    uint64_t lines;
+    uint64_t hash;
+
+} PerftCase;
+
+// Golden values. Any change to the rules, the randomizer or the move
+// generator that alters them is a behaviour change, not an optimization.
+// After such a change, check it was intended and copy the measured leaves,
+// lines and hash that tetris-bench prints into the last three columns.
+static const PerftCase PERFT_CASES[] = {
+    { "empty", 1, RANDOMIZER_UNIFORM, SETUP_EMPTY, 4, 91741, 120, 0xc5b31530e1822f21ULL },
+    { "empty-bag", 2, RANDOMIZER_BAG, SETUP_EMPTY, 4, 384134, 112, 0xcf3d743cd234d7f6ULL },
+    { "garbage", 3, RANDOMIZER_UNIFORM, SETUP_GARBAGE, 4, 393364, 23869, 0x901e8d2894ae87f0ULL },
+    { "overhangs", 4, RANDOMIZER_BAG, SETUP_OVERHANGS, 4, 123549, 15954, 0x9e52842daee374d2ULL },
+    { "tetris-ready", 5, RANDOMIZER_UNIFORM, SETUP_TETRIS_READY, 4, 387671, 55207, 0x1a0b4407b0c1df0dULL },
+};
+
+#define NUM_PERFT_CASES (sizeof(PERFT_CASES) / sizeof(PERFT_CASES[0]))
+
+typedef struct
+{
+    uint64_t nodes;
+    uint64_t leaves;
+    uint64_t lines;
+    uint64_t hash;
+
+} PerftCount;
+
+typedef struct
+{
+    const Game* root;
+    const Placement* placements;
+    int depth;
+    PerftCount* counts;
+
+} PerftJob;
+
+typedef struct
+{
+    const char* name;
+    uint64_t iterations;
+    double seconds;
+
+} MicroResult;
+
+// A check of one part of the engine; failure is printed when it finds any
+// mismatches.
+typedef struct
+{
+    const char* name;
+    const char* failure;
+    int mismatches;
+    bool skipped;
+
+} CheckResult;
+
+// Keeps the compiler from discarding the work of a microbenchmark loop.
+static volatile uint64_t sink;
+
+static void setupBoard(Board* board, BoardSetup setup)
+{
+    Rng rng;
+    Rng_Seed(&rng, 0x5eed, 1);
+
+    switch (setup) {
+    case SETUP_EMPTY:
+        break;
+    case SETUP_GARBAGE:
+        // Six rows, each with a single random hole
+        for (int row = BOARD_ROWS - 6; row < BOARD_ROWS; row++) {
+            const uint32_t hole = Rng_Below(&rng, BOARD_COLUMNS);
+            for (int column = 0; column < BOARD_COLUMNS; column++) {
+                if ((uint32_t)column != hole)
+                    Board_SetCell(board, (uint8_t)row, (uint8_t)column, I);
+            }
+        }
+        break;
+    case SETUP_OVERHANGS:
+        // A stack with roofs that can only be filled by sliding or spinning
+        // pieces underneath them
+        for (int column = 0; column < BOARD_COLUMNS; column++) {
+            if (column != 4 && column != 5)
+                Board_SetCell(board, BOARD_ROWS - 1, (uint8_t)column, J);
+            if (column < 3 || column > 7)
+                Board_SetCell(board, BOARD_ROWS - 2, (uint8_t)column, L);
+        }
+        Board_SetCell(board, BOARD_ROWS - 3, 2, T);
+        Board_SetCell(board, BOARD_ROWS - 3, 3, T);
+        Board_SetCell(board, BOARD_ROWS - 3, 7, S);
+        Board_SetCell(board, BOARD_ROWS - 3, 8, S);
+        Board_SetCell(board, BOARD_ROWS - 4, 0, Z);
+        Board_SetCell(board, BOARD_ROWS - 4, 9, Z);
+        break;
+    case SETUP_TETRIS_READY:
+        // Four rows full except for the rightmost column
+        for (int row = BOARD_ROWS - 4; row < BOARD_ROWS; row++) {
+            for (int column = 0; column < BOARD_COLUMNS - 1; column++)
+                Board_SetCell(board, (uint8_t)row, (uint8_t)column, O);
+        }
+        break;
+    }
+}
+
+static void initCase(Game* game, const PerftCase* test)
+{
+    GameConfig config = Game_DefaultConfig(test->seed);
+    config.randomizer = test->randomizer;
+    Game_Init(game, &config);
+    setupBoard(&game->board, test->setup);
+    game->shadowDirty = true;
+}
+
+// Counts every position reachable by locking depth more pieces. Leaves are
+// the positions at depth zero and games that ended early; the hash sums the
+// leaf boards so that neither the order of placements nor duplicate boards
+// reached by different paths cancel out.
+static void perft(const Game* game, int depth, PerftCount* count)
+{
+    count->nodes++;
+    if (depth == 0 || game->gameOver) {
+        count->leaves++;
+        count->lines += game->lines;
+        count->hash += Board_Hash(&game->board);
+        return;
+    }
+
+    Placement placements[MOVEGEN_MAX_PLACEMENTS];
+    const size_t numPlacements = MoveGen_Placements(&game->board, &game->currentBlock, placements);
+    for (size_t i = 0; i < numPlacements; i++) {
+        Game child = *game;
+        Game_ApplyPlacement(&child, &placements[i]);
+        perft(&child, depth - 1, count);
+    }
+}
+
+static void perftRootMove(void* context, size_t index, int worker)
+{
+    (void)worker;
+    const PerftJob* job = context;
+    Game child = *job->root;
+    Game_ApplyPlacement(&child, &job->placements[index]);
+    perft(&child, job->depth - 1, &job->counts[index]);
+}
+
+// Splits the search over the root placements; returns wall-clock seconds.
+static double runPerft(const PerftCase* test, int numThreads, PerftCount* total)
+{
+    Game root;
+    initCase(&root, test);
+
+    Placement placements[MOVEGEN_MAX_PLACEMENTS];
+    const size_t numPlacements = MoveGen_Placements(&root.board, &root.currentBlock, placements);
+    PerftCount* counts = calloc(numPlacements + 1, sizeof(PerftCount));
+    if (!counts) {
+        fprintf(stderr, "tetris-bench: out of memory\n");
+        exit(1);
+    }
+
+    PerftJob job = { &root, placements, test->depth, counts };
+    const double start = Pool_Now();
+    if (Pool_Run(numThreads, numPlacements, perftRootMove, &job, NULL) != 0) {
+        fprintf(stderr, "tetris-bench: failed to start worker pool\n");
+        exit(1);
+    }
+    const double seconds = Pool_Now() - start;
+
+    *total = (PerftCount) { 1, 0, 0, 0 };
+    for (size_t i = 0; i < numPlacements; i++) {
+        total->nodes += counts[i].nodes;
+        total->leaves += counts[i].leaves;
+        total->lines += counts[i].lines;
+        total->hash += counts[i].hash;
+    }
+    free(counts);
+    return seconds;
+}
+
+// Microbenchmarks. Each one cycles through a small table of prepared inputs
+// so that no call can be hoisted out of the loop.
+
+#define MICRO_INPUTS 256
+#define MICRO_ITERATIONS 4000000
+#define MICRO_DROPS (MICRO_ITERATIONS / 4)
+
+static Board microBoards[MICRO_INPUTS];
+static Block microBlocks[MICRO_INPUTS];
+
+// Random blocks that lie inside the board, over random jagged stacks with
+// about one row in four full.
+static void setupMicroInputs(void)
+{
+    Rng rng;
+    Rng_Seed(&rng, 0xbe7c4, 2);
+
+    for (int i = 0; i < MICRO_INPUTS; i++) {
+        Board* board = &microBoards[i];
+        Board_Init(board);
+        const int height = 4 + (int)Rng_Below(&rng, 12);
+        for (int row = BOARD_ROWS - height; row < BOARD_ROWS; row++) {
+            const bool full = Rng_Below(&rng, 4) == 0;
+            for (int column = 0; column < BOARD_COLUMNS; column++) {
+                if (full || Rng_Below(&rng, 3) != 0)
+                    Board_SetCell(board, (uint8_t)row, (uint8_t)column, (uint8_t)(1 + Rng_Below(&rng, NUM_BLOCKS)));
+            }
+        }
+
+        Block* block = &microBlocks[i];
+        *block = Block_Init((BlockType)(1 + Rng_Below(&rng, NUM_BLOCKS)));
+        block->rotationState = (int8_t)Rng_Below(&rng, block->numRotations);
+        const PieceShape* shape = Block_GetShape(block);
+        block->rowOffset = (int8_t)(Rng_Below(&rng, (uint32_t)(BOARD_ROWS - (shape->bottom - shape->top))) - shape->top);
+        block->columnOffset
+            = (int8_t)(Rng_Below(&rng, (uint32_t)(BOARD_COLUMNS - (shape->right - shape->left))) - shape->left);
+    }
+}
+
+static MicroResult benchBlockFits(void)
+{
+    uint64_t fits = 0;
+    const double start = Pool_Now();
+    for (uint64_t i = 0; i < MICRO_ITERATIONS; i++)
+        fits += blockFits(&microBoards[i % MICRO_INPUTS], &microBlocks[(i * 7) % MICRO_INPUTS]);
+    const double seconds = Pool_Now() - start;
+    sink = fits;
+    return (MicroResult) { "blockFits", MICRO_ITERATIONS, seconds };
+}
+
+// Includes copying the board, since clearing destroys the input.
+static MicroResult benchClearFullRows(void)
+{
+    uint64_t cleared = 0;
+    const double start = Pool_Now();
+    for (uint64_t i = 0; i < MICRO_ITERATIONS; i++) {
+        Board board = microBoards[i % MICRO_INPUTS];
+        cleared += Board_ClearFullRows(&board);
+    }
+    const double seconds = Pool_Now() - start;
+    sink = cleared;
+    return (MicroResult) { "Board_ClearFullRows", MICRO_ITERATIONS, seconds };
+}
+
+static MicroResult benchUpdateShadowBlock(void)
+{
+    static Game games[MICRO_INPUTS];
+    for (int i = 0; i < MICRO_INPUTS; i++) {
+        GameConfig config = Game_DefaultConfig((uint64_t)i);
+        Game_Init(&games[i], &config);
+        games[i].board = microBoards[i];
+        games[i].currentBlock = microBlocks[(i * 7) % MICRO_INPUTS];
+    }
+
+    uint64_t rows = 0;
+    const double start = Pool_Now();
+    for (uint64_t i = 0; i < MICRO_ITERATIONS; i++) {
+        Game* game = &games[i % MICRO_INPUTS];
+        game->shadowDirty = true;
+        Game_UpdateShadowBlock(game);
+        rows += (uint64_t)game->shadowBlock.rowOffset;
+    }
+    const double seconds = Pool_Now() - start;
+    sink = rows;
+    return (MicroResult) { "Game_UpdateShadowBlock", MICRO_ITERATIONS, seconds };
+}
+
+static MicroResult benchGetCellPositions(void)
+{
+    uint64_t total = 0;
+    const double start = Pool_Now();
+    for (uint64_t i = 0; i < MICRO_ITERATIONS; i++) {
+        Position positions[NUM_BLOCK_CELLS];
+        size_t count;
+        Block_GetCellPositions(&microBlocks[i % MICRO_INPUTS], positions, &count);
+        total += count + (uint64_t)positions[0].row + (uint64_t)positions[count - 1].column;
+    }
+    const double seconds = Pool_Now() - start;
+    sink = total;
+    return (MicroResult) { "Block_GetCellPositions", MICRO_ITERATIONS, seconds };
+}
+
+static const char* BATCH_KERNEL_NAMES[NUM_BATCH_KERNELS] = { "scalar", "sse2", "avx2" };
+static const char* BATCH_DROP_NAMES[NUM_BATCH_KERNELS] = { "drop batch scalar", "drop batch sse2", "drop batch avx2" };
+
+// Microbenchmark block i, either where it lies or lifted to the top row as
+// if just spawned. Every fifth one is pushed partly off the board.
+static Block microBlock(uint64_t i, bool spawned)
+{
+    Block block = microBlocks[(i * 7) % MICRO_INPUTS];
+    if (spawned)
+        block.rowOffset = (int8_t)-Block_GetShape(&block)->top;
+    if (i % 5 == 0)
+        block.columnOffset -= 3;
+    return block;
+}
+
+// Drops each batch lane's block as Board_TryMove would, locks it and clears
+// full rows, checking every step against the one-board functions. Half of
+// the groups start from the top row. Returns the number of disagreements.
+static int checkBatchKernel(BatchKernel kernel)
+{
+    BoardBatch_UseKernel(kernel);
+    int mismatches = 0;
+    for (int first = 0; first < MICRO_INPUTS; first += BATCH_LANES) {
+        BoardBatch batch;
+        Board boards[BATCH_LANES];
+        Block blocks[BATCH_LANES];
+        BoardBatch_Init(&batch);
+        for (int lane = 0; lane < BATCH_LANES; lane++) {
+            boards[lane] = microBoards[first + lane];
+            blocks[lane] = microBlock((uint64_t)(first + lane), (first / BATCH_LANES) % 2 == 0);
+            BoardBatch_SetBoard(&batch, lane, &boards[lane]);
+            BoardBatch_SetBlock(&batch, lane, &blocks[lane]);
+        }
+
+        BatchLanes fits = 0;
+        for (int lane = 0; lane < BATCH_LANES; lane++) {
+            if (Board_CanPlace(&boards[lane], &blocks[lane]))
+                fits |= (BatchLanes)(1u << lane);
+        }
+        mismatches += BoardBatch_Fits(&batch) != fits;
+
+        for (BatchLanes falling = fits; falling != 0;) {
+            BatchLanes moved = 0;
+            for (int lane = 0; lane < BATCH_LANES; lane++) {
+                if ((falling & (1u << lane)) && Board_TryMove(&boards[lane], &blocks[lane], (Position) { 1, 0 }))
+                    moved |= (BatchLanes)(1u << lane);
+            }
+            if (BoardBatch_StepDown(&batch, falling) != moved) {
+                mismatches++;
+                break;
+            }
+            falling = moved;
+        }
+
+        BoardBatch_Lock(&batch, fits);
+        BatchLanes full[BOARD_ROWS];
+        BoardBatch_FullRows(&batch, full);
+        for (int lane = 0; lane < BATCH_LANES; lane++) {
+            if (fits & (1u << lane))
+                Board_PlaceBlock(&boards[lane], &blocks[lane]);
+            for (int row = 0; row < BOARD_ROWS; row++)
+                mismatches += Board_IsRowFull(&boards[lane], (uint8_t)row) != ((full[row] >> lane) & 1);
+            mismatches += BoardBatch_ClearFullRows(&batch, lane) != Board_ClearFullRows(&boards[lane]);
+
+            uint16_t rows[BOARD_ROWS];
+            BoardBatch_GetRows(&batch, lane, rows);
+            mismatches += memcmp(rows, boards[lane].rows, sizeof(rows)) != 0;
+        }
+    }
+    return mismatches;
+}
+
+// Drops freshly spawned blocks one step at a time, locks them and clears
+// full rows, one board at a time. Each op is one block.
+static MicroResult benchDrop(void)
+{
+    uint64_t locked = 0;
+    const double start = Pool_Now();
+    for (uint64_t i = 0; i < MICRO_DROPS; i++) {
+        Board board = microBoards[i % MICRO_INPUTS];
+        Block block = microBlock(i, true);
+        if (!Board_CanPlace(&board, &block))
+            continue;
+        while (Board_TryMove(&board, &block, (Position) { 1, 0 }))
+            ;
+        Board_PlaceBlock(&board, &block);
+        locked += Board_ClearFullRows(&board) + 1;
+    }
+    const double seconds = Pool_Now() - start;
+    sink = locked;
+    return (MicroResult) { "drop one board", MICRO_DROPS, seconds };
+}
+
+// The same drops, sixteen boards at a time.
+static MicroResult benchBatchDrop(BatchKernel kernel)
+{
+    BoardBatch_UseKernel(kernel);
+    uint64_t locked = 0;
+    const double start = Pool_Now();
+    for (uint64_t i = 0; i < MICRO_DROPS; i += BATCH_LANES) {
+        BoardBatch batch;
+        batch.outside = 0;
+        for (int lane = 0; lane < BATCH_LANES; lane++) {
+            const Block block = microBlock(i + (uint64_t)lane, true);
+            BoardBatch_SetBoard(&batch, lane, &microBoards[(i + (uint64_t)lane) % MICRO_INPUTS]);
+            BoardBatch_SetBlock(&batch, lane, &block);
+        }
+
+        const BatchLanes fits = BoardBatch_Fits(&batch);
+        for (BatchLanes falling = fits; falling != 0;)
+            falling = BoardBatch_StepDown(&batch, falling);
+        BoardBatch_Lock(&batch, fits);
+
+        BatchLanes full[BOARD_ROWS];
+        for (BatchLanes lanes = BoardBatch_FullRows(&batch, full); lanes != 0; lanes &= lanes - 1)
+            locked += BoardBatch_ClearFullRows(&batch, Bits_LowestIndex(lanes));
+        locked += (uint64_t)Bits_Count(fits);
+    }
+    const double seconds = Pool_Now() - start;
+    sink = locked;
+    return (MicroResult) { BATCH_DROP_NAMES[kernel], MICRO_DROPS, seconds };
+}
+
+// Features
+
+#define FEATURE_CHECK_GAMES 20
+#define FEATURE_CHECK_PIECES 200
+#define MAX_FEATURE_CANDIDATES 8192
+
+static FeatureTracker featureTrackers[MICRO_INPUTS];
+static Board featureBoards[MICRO_INPUTS];
+static Block featureCandidates[MAX_FEATURE_CANDIDATES];
+static uint8_t featureCandidateBoards[MAX_FEATURE_CANDIDATES];
+static size_t numFeatureCandidates;
+
+static bool isFilled(const Board* board, int row, int column)
+{
+    if (row >= BOARD_ROWS || column < 0 || column >= BOARD_COLUMNS)
+        return true;
+    return !Board_IsEmpty(board, (uint8_t)row, (uint8_t)column);
+}
+
+// Cell by cell, straight from the definitions in tetris_core.h.
+static BoardFeatures referenceFeatures(const Board* board, int linesCleared)
+{
+    BoardFeatures features = { 0 };
+    features.linesCleared = linesCleared;
+    int previousHeight = 0;
+    for (int column = 0; column < BOARD_COLUMNS; column++) {
+        int top = 0;
+        while (top < BOARD_ROWS && !isFilled(board, top, column))
+            top++;
+        features.height += BOARD_ROWS - top;
+        if (column > 0)
+            features.bumpiness += abs(BOARD_ROWS - top - previousHeight);
+        previousHeight = BOARD_ROWS - top;
+
+        int depth = 0;
+        for (int row = 0; row < top; row++) {
+            depth = isFilled(board, row, column - 1) && isFilled(board, row, column + 1) ? depth + 1 : 0;
+            features.wells += depth;
+        }
+        bool holeBelow = false;
+        for (int row = BOARD_ROWS - 1; row >= top; row--) {
+            if (!isFilled(board, row, column)) {
+                features.holes++;
+                holeBelow = true;
+            } else if (holeBelow) {
+                features.coveredCells++;
+            }
+        }
+        for (int row = 0; row < BOARD_ROWS; row++)
+            features.columnTransitions += isFilled(board, row, column) != isFilled(board, row + 1, column);
+    }
+    for (int row = 0; row < BOARD_ROWS; row++) {
+        for (int column = -1; column < BOARD_COLUMNS; column++)
+            features.rowTransitions += isFilled(board, row, column) != isFilled(board, row, column + 1);
+    }
+    return features;
+}
+
+static bool sameFeatures(const BoardFeatures* a, const BoardFeatures* b)
+{
+    return a->height == b->height && a->holes == b->holes && a->bumpiness == b->bumpiness && a->wells == b->wells
+        && a->rowTransitions == b->rowTransitions && a->columnTransitions == b->columnTransitions
+        && a->coveredCells == b->coveredCells && a->linesCleared == b->linesCleared;
+}
+
+// Plays games greedily on the tracker's own evaluations, checking every
+// candidate placement and every lock against referenceFeatures. Returns the
+// number of disagreements.
+static int checkFeatures(void)
+{
+    static Placement placements[MOVEGEN_MAX_PLACEMENTS];
+    int mismatches = 0;
+    for (uint64_t seed = 1; seed <= FEATURE_CHECK_GAMES; seed++) {
+        GameConfig config = Game_DefaultConfig(seed);
+        config.randomizer = seed % 2 ? RANDOMIZER_UNIFORM : RANDOMIZER_BAG;
+        Game game;
+        Game_Init(&game, &config);
+        FeatureTracker tracker;
+        FeatureTracker_Init(&tracker, &game.board);
+
+        while (!game.gameOver && game.pieces < FEATURE_CHECK_PIECES) {
+            const size_t count = MoveGen_Placements(&game.board, &game.currentBlock, placements);
+            if (count == 0)
+                break;
+            size_t best = 0;
+            int bestScore = 0;
+            for (size_t i = 0; i < count; i++) {
+                Block block = game.currentBlock;
+                block.rotationState = placements[i].rotation;
+                block.rowOffset = placements[i].row;
+                block.columnOffset = placements[i].column;
+                const BoardFeatures features = FeatureTracker_Evaluate(&tracker, &block);
+
+                Game trial = game;
+                Game_ApplyPlacement(&trial, &placements[i]);
+                const BoardFeatures expected = referenceFeatures(&trial.board, (int)(trial.lines - game.lines));
+                mismatches += !sameFeatures(&features, &expected);
+
+                const int score = 16 * features.linesCleared - 4 * features.holes - features.height - features.wells;
+                if (i == 0 || score > bestScore) {
+                    bestScore = score;
+                    best = i;
+                }
+            }
+
+            Block block = game.currentBlock;
+            block.rotationState = placements[best].rotation;
+            block.rowOffset = placements[best].row;
+            block.columnOffset = placements[best].column;
+            const uint32_t lines = game.lines;
+            FeatureTracker_Lock(&tracker, &block);
+            Game_ApplyPlacement(&game, &placements[best]);
+            const BoardFeatures expected = referenceFeatures(&game.board, (int)(game.lines - lines));
+            mismatches += !sameFeatures(&tracker.features, &expected);
+            mismatches += memcmp(tracker.rows, game.board.rows, sizeof(tracker.rows)) != 0;
+        }
+    }
+    return mismatches;
+}
+
+// Every placement of a fresh block on each microbenchmark board, with its
+// full rows cleared first as they would be in a game.
+static void setupFeatureInputs(void)
+{
+    static Placement placements[MOVEGEN_MAX_PLACEMENTS];
+    for (int i = 0; i < MICRO_INPUTS; i++) {
+        featureBoards[i] = microBoards[i];
+        Board_ClearFullRows(&featureBoards[i]);
+        FeatureTracker_Init(&featureTrackers[i], &featureBoards[i]);
+
+        const Block start = Block_Init((BlockType)microBlocks[i].id);
+        const size_t count = MoveGen_Placements(&featureBoards[i], &start, placements);
+        for (size_t k = 0; k < count && numFeatureCandidates < MAX_FEATURE_CANDIDATES; k++) {
+            Block* block = &featureCandidates[numFeatureCandidates];
+            *block = start;
+            block->rotationState = placements[k].rotation;
+            block->rowOffset = placements[k].row;
+            block->columnOffset = placements[k].column;
+            featureCandidateBoards[numFeatureCandidates++] = (uint8_t)i;
+        }
+    }
+}
+
+// Locks each candidate on a copy of its board and evaluates that.
+static MicroResult benchFeaturesFromScratch(void)
+{
+    int64_t total = 0;
+    const double start = Pool_Now();
+    for (uint64_t i = 0; i < MICRO_DROPS; i++) {
+        const size_t candidate = i % numFeatureCandidates;
+        Board board = featureBoards[featureCandidateBoards[candidate]];
+        Board_PlaceBlock(&board, &featureCandidates[candidate]);
+        Board_ClearFullRows(&board);
+        FeatureTracker tracker;
+        FeatureTracker_Init(&tracker, &board);
+        total += tracker.features.holes;
+    }
+    const double seconds = Pool_Now() - start;
+    sink = (uint64_t)total;
+    return (MicroResult) { "features from scratch", MICRO_DROPS, seconds };
+}
+
+static MicroResult benchFeaturesDelta(void)
+{
+    int64_t total = 0;
+    const double start = Pool_Now();
+    for (uint64_t i = 0; i < MICRO_DROPS; i++) {
+        const size_t candidate = i % numFeatureCandidates;
+        const BoardFeatures features = FeatureTracker_Evaluate(
+            &featureTrackers[featureCandidateBoards[candidate]], &featureCandidates[candidate]);
+        total += features.holes;
+    }
+    const double seconds = Pool_Now() - start;
+    sink = (uint64_t)total;
+    return (MicroResult) { "features delta", MICRO_DROPS, seconds };
+}
+
+// Zobrist hashing
+
+#define ZOBRIST_CHECK_GAMES 20
+#define ZOBRIST_CHECK_PIECES 200
+#define ZOBRIST_CHECK_EDITS 64
+#define TABLE_BENCH_BYTES (16u << 20)
+#define TABLE_BENCH_POSITIONS (3u << 20)
+
+// Compares the incremental hash with one computed from scratch after every
+// lock of some heuristic games, and after every edit of a run of random
+// Board_SetCell, Board_ClearRow and Board_MoveRowDown calls on each
+// microbenchmark board. Returns the number of disagreements.
+static int checkZobrist(void)
+{
+    int mismatches = 0;
+    for (uint64_t seed = 1; seed <= ZOBRIST_CHECK_GAMES; seed++) {
+        GameConfig config = Game_DefaultConfig(seed);
+        config.randomizer = seed % 2 ? RANDOMIZER_UNIFORM : RANDOMIZER_BAG;
+        Game game;
+        Game_Init(&game, &config);
+        Policy policy;
+        Policy_Init(&policy, POLICY_HEURISTIC, seed, NULL);
+        while (!game.gameOver && game.pieces < ZOBRIST_CHECK_PIECES) {
+            Policy_PlayPiece(&policy, &game);
+            mismatches += game.board.zobrist != Board_Zobrist(&game.board);
+        }
+    }
+
+    Rng rng;
+    Rng_Seed(&rng, 0x2067, 3);
+    for (int i = 0; i < MICRO_INPUTS; i++) {
+        Board board = microBoards[i];
+        mismatches += board.zobrist != Board_Zobrist(&board);
+        for (int edit = 0; edit < ZOBRIST_CHECK_EDITS; edit++) {
+            const uint8_t row = (uint8_t)Rng_Below(&rng, BOARD_ROWS);
+            switch (Rng_Below(&rng, 4)) {
+            case 0:
+                Board_ClearRow(&board, row);
+                break;
+            case 1:
+                if (row + 1 < BOARD_ROWS)
+                    Board_MoveRowDown(&board, row, (uint8_t)(1 + Rng_Below(&rng, BOARD_ROWS - 1 - row)));
+                break;
+            default:
+                Board_SetCell(&board, row, (uint8_t)Rng_Below(&rng, BOARD_COLUMNS),
+                    (uint8_t)Rng_Below(&rng, NUM_BLOCKS + 1));
+                break;
+            }
+            mismatches += board.zobrist != Board_Zobrist(&board);
+        }
+        Board_ClearFullRows(&board);
+        mismatches += board.zobrist != Board_Zobrist(&board);
+    }
+    return mismatches;
+}
+
+// Probes for positions drawn from three times as many as the table has
+// slots, storing on a miss as a search does.
+static MicroResult benchTable(TranspositionStats* stats)
+{
+    TranspositionTable table;
+    if (!TranspositionTable_Init(&table, TABLE_BENCH_BYTES)) {
+        fprintf(stderr, "tetris-bench: out of memory\n");
+        exit(1);
+    }
+    memset(stats, 0, sizeof(*stats));
+    uint64_t total = 0;
+    const double start = Pool_Now();
+    for (uint64_t i = 0; i < MICRO_ITERATIONS; i++) {
+        const uint64_t key = Hash_Mix64((i * 0x9e3779b97f4a7c15ULL) % TABLE_BENCH_POSITIONS + 1);
+        uint64_t data;
+        if (TranspositionTable_Probe(&table, key, &data, stats))
+            total += data;
+        else
+            TranspositionTable_Store(&table, key, i, stats);
+    }
+    const double seconds = Pool_Now() - start;
+    sink = total;
+    TranspositionTable_Free(&table);
+    return (MicroResult) { "table probe", MICRO_ITERATIONS, seconds };
+}
+
+// Checks
+
+#define ALLOCATION_CHECK_PIECES 200
+
+// Plays every policy, restarting games as they end, and checks that the
+// core's debug allocation counter never moves. Release builds don't count.
+static CheckResult checkAllocations(void)
+{
+    CheckResult result = { "allocations", "the core allocated during play", 0, false };
+#ifdef NDEBUG
+    result.skipped = true;
+#else
+    for (int type = 0; type < NUM_POLICIES; type++) {
+        GameConfig config = Game_DefaultConfig((uint64_t)type + 1);
+        Game game;
+        Game_Init(&game, &config);
+        Policy policy;
+        Policy_Init(&policy, (PolicyType)type, (uint64_t)type + 1, "LLUD");
+        const size_t before = Core_AllocationCount();
+        for (int piece = 0; piece < ALLOCATION_CHECK_PIECES; piece++) {
+            if (game.gameOver)
+                Game_Apply(&game, ACTION_RESTART);
+            Policy_PlayPiece(&policy, &game);
+            Game_Advance(&game);
+        }
+        result.mismatches += Core_AllocationCount() != before;
+    }
+#endif
+    return result;
+}
+
+// Input scripts: key events and the actions expected on each tick from 0,
+// as one field per tick of L (left), R (right), U (rotate), D (drop) and
+// X (restart), with - for none.
+typedef struct
+{
+    InputConfig config;
+    InputEvent events[8];
+    size_t numEvents;
+    const char* expected;
+
+} InputScript;
+
+static const InputScript INPUT_SCRIPTS[] = {
+    // DAS, then one move every ARR ticks until release
+    { { 3, 2 }, { { 0, ACTION_MOVE_LEFT, true }, { 10, ACTION_MOVE_LEFT, false } }, 2, "L - - L - L - L - L - -" },
+    // ARR 0 slides to the wall every tick once DAS is up
+    { { 3, 0 }, { { 0, ACTION_MOVE_RIGHT, true }, { 5, ACTION_MOVE_RIGHT, false } }, 2,
+        "R - - RRRRRRRRRR RRRRRRRRRR - -" },
+    // Pressing the other direction takes over; releasing it hands back,
+    // starting DAS over
+    { { 3, 2 },
+        { { 0, ACTION_MOVE_LEFT, true }, { 2, ACTION_MOVE_RIGHT, true }, { 6, ACTION_MOVE_RIGHT, false },
+            { 12, ACTION_MOVE_LEFT, false } },
+        4, "L - R - - R - - - L - L - -" },
+    // OS repeats of held keys change nothing
+    { { 3, 2 },
+        { { 0, ACTION_MOVE_LEFT, true }, { 1, ACTION_MOVE_LEFT, true }, { 2, ACTION_MOVE_LEFT, true },
+            { 4, ACTION_ROTATE, true }, { 5, ACTION_ROTATE, true }, { 6, ACTION_MOVE_LEFT, false },
+            { 7, ACTION_ROTATE, false } },
+        7, "L - - L U L - -" },
+};
+
+#define NUM_INPUT_SCRIPTS (sizeof(INPUT_SCRIPTS) / sizeof(INPUT_SCRIPTS[0]))
+
+// Feeds each script through Input_Tick and compares the actions of every
+// tick with the expected ones.
+static CheckResult checkInput(void)
+{
+    static const char ACTION_LETTERS[NUM_ACTIONS] = { '-', 'L', 'R', 'U', 'D', 'X' };
+    CheckResult result = { "input", "auto shift disagrees with the scripted actions", 0, false };
+    for (size_t i = 0; i < NUM_INPUT_SCRIPTS; i++) {
+        const InputScript* script = &INPUT_SCRIPTS[i];
+        Input input;
+        Input_Init(&input, &script->config);
+        for (size_t k = 0; k < script->numEvents; k++)
+            Input_Push(&input, script->events[k]);
+
+        // Every tick adds at least one character, so this stops by the
+        // last expected tick
+        const size_t expectedLength = strlen(script->expected);
+        char actual[256];
+        size_t length = 0;
+        for (uint32_t tick = 0; length < expectedLength && length + INPUT_MAX_ACTIONS + 2 < sizeof(actual); tick++) {
+            Action actions[INPUT_MAX_ACTIONS];
+            const size_t count = Input_Tick(&input, tick, actions);
+            if (tick > 0)
+                actual[length++] = ' ';
+            if (count == 0)
+                actual[length++] = '-';
+            for (size_t k = 0; k < count; k++)
+                actual[length++] = ACTION_LETTERS[actions[k]];
+        }
+        actual[length] = '\0';
+        result.mismatches += strcmp(actual, script->expected) != 0;
+    }
+    return result;
+}
+
+#define REPLAY_CHECK_TICKS 1500
+#define REPLAY_CHECK_BYTES (1u << 16)
+
+static size_t putTestVarint(uint8_t* out, uint64_t value)
+{
+    size_t length = 0;
+    while (value >= 0x80) {
+        out[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = (uint8_t)value;
+    return length;
+}
+
+// A replay header for seed 1, uniform pieces, 60 Hz and gravity every 18
+// ticks, followed by one event.
+static size_t buildTestReplay(uint8_t* out, uint64_t event)
+{
+    const uint8_t header[] = { 'T', 'R', 'P', 'L', REPLAY_VERSION, 1, RANDOMIZER_UNIFORM, 60, 18 };
+    memcpy(out, header, sizeof(header));
+    return sizeof(header) + putTestVarint(out + sizeof(header), event);
+}
+
+// Records a game of random inputs through a file and plays it back, then
+// checks that every shortened copy is reported truncated or corrupt, that a
+// bad magic, version, action or tick delta is corrupt, and that a changed
+// board hash is a mismatch.
+static CheckResult checkReplay(void)
+{
+    CheckResult result = { "replay", "a replay did not play back as expected", 0, false };
+    static uint8_t data[REPLAY_CHECK_BYTES];
+    static Game game;
+    static ReplayWriter writer;
+
+    FILE* file = tmpfile();
+    if (file == NULL) {
+        result.skipped = true;
+        return result;
+    }
+    GameConfig config = Game_DefaultConfig(0x5e1f);
+    Game_Init(&game, &config);
+    ReplayWriter_Open(&writer, file, &config);
+    Rng rng;
+    Rng_Seed(&rng, 0x5e1f, 4);
+    while (game.ticks < REPLAY_CHECK_TICKS) {
+        if (game.gameOver) {
+            ReplayWriter_Action(&writer, game.ticks, ACTION_RESTART);
+            Game_Apply(&game, ACTION_RESTART);
+        } else if (Rng_Below(&rng, 4) == 0) {
+            const uint32_t choices = ACTION_HARD_DROP - ACTION_MOVE_LEFT + 1;
+            const Action action = (Action)(ACTION_MOVE_LEFT + Rng_Below(&rng, choices));
+            ReplayWriter_Action(&writer, game.ticks, action);
+            Game_Apply(&game, action);
+        }
+        Game_Advance(&game);
+    }
+    result.mismatches += !ReplayWriter_Close(&writer, &game);
+    rewind(file);
+    const size_t length = fread(data, 1, sizeof(data), file);
+    fclose(file);
+
+    static Game played;
+    result.mismatches += Replay_Play(data, length, &played, NULL) != REPLAY_OK;
+    for (size_t shorter = 0; shorter < length; shorter++) {
+        const ReplayStatus status = Replay_Play(data, shorter, &played, NULL);
+        result.mismatches += status != REPLAY_TRUNCATED && status != REPLAY_CORRUPT;
+    }
+    data[length - 1] ^= 0x80;
+    result.mismatches += Replay_Play(data, length, &played, NULL) != REPLAY_MISMATCH;
+    data[length - 1] ^= 0x80;
+    data[0] ^= 0xff;
+    result.mismatches += Replay_Play(data, length, &played, NULL) != REPLAY_CORRUPT;
+    data[0] ^= 0xff;
+    data[4]++;
+    result.mismatches += Replay_Play(data, length, &played, NULL) != REPLAY_CORRUPT;
+
+    uint8_t corrupt[32];
+    result.mismatches
+        += Replay_Play(corrupt, buildTestReplay(corrupt, (1u << REPLAY_ACTION_BITS) - 1), &played, NULL)
+        != REPLAY_CORRUPT;
+    const uint64_t farTick = (uint64_t)UINT32_MAX << REPLAY_ACTION_BITS | ACTION_ROTATE;
+    result.mismatches += Replay_Play(corrupt, buildTestReplay(corrupt, farTick), &played, NULL) != REPLAY_CORRUPT;
+    return result;
+}
+
+#define REWIND_CHECK_TICKS 8
+#define REWIND_CHECK_PUSHES 2000
+
+// Pushes states into a rewind buffer a few ticks long, stepping back a random
+// number of ticks now and then and comparing the state restored with the
+// one saved when it was pushed. Every other push jumps to another game on a
+// board of random cells, whose large delta makes the byte ring wrap and drop
+// old states early; the check fails unless both happen.
+static CheckResult checkRewind(void)
+{
+    CheckResult result = { "rewind", "a rewound state differs from the one pushed", 0, false };
+    static GameSnapshot history[REWIND_CHECK_PUSHES];
+    Rewind rewind;
+    if (!Rewind_Init(&rewind, REWIND_CHECK_TICKS)) {
+        result.skipped = true;
+        return result;
+    }
+
+    GameConfig config = Game_DefaultConfig(0x4e3);
+    Game game;
+    Game_Init(&game, &config);
+    Rng rng;
+    Rng_Seed(&rng, 0x4e3, 5);
+    bool wrapped = false;
+    bool droppedEarly = false;
+    size_t numStates = 0;
+    for (int push = 0; push < REWIND_CHECK_PUSHES; push++) {
+        if (Rng_Below(&rng, 2) == 0) {
+            config = Game_DefaultConfig(Rng_Next(&rng));
+            Game_Init(&game, &config);
+            for (uint8_t row = 0; row < BOARD_ROWS; row++) {
+                for (uint8_t column = 0; column < BOARD_COLUMNS; column++)
+                    Board_SetCell(&game.board, row, column, (uint8_t)Rng_Below(&rng, NUM_COLORS));
+            }
+        } else {
+            if (game.gameOver)
+                Game_Apply(&game, ACTION_RESTART);
+            else if (Rng_Below(&rng, 4) == 0)
+                Game_Apply(&game, (Action)(ACTION_MOVE_LEFT + Rng_Below(&rng, ACTION_HARD_DROP)));
+            Game_Advance(&game);
+        }
+
+        const bool hadLatest = rewind.hasLatest;
+        const size_t length = Rewind_Length(&rewind);
+        Rewind_Push(&rewind, &game);
+        Game_Save(&game, &history[numStates++]);
+        wrapped |= rewind.byteStart + rewind.byteCount > rewind.byteCapacity;
+        droppedEarly |= hadLatest && length < REWIND_CHECK_TICKS && Rewind_Length(&rewind) <= length;
+
+        if (Rng_Below(&rng, 8) == 0) {
+            const size_t ticks = Rng_Below(&rng, (uint32_t)Rewind_Length(&rewind) + 1);
+            result.mismatches += !Rewind_Back(&rewind, ticks, &game);
+            numStates -= ticks;
+            result.mismatches += memcmp(&game, &history[numStates - 1].game, sizeof(Game)) != 0;
+        }
+    }
+    result.mismatches += Rewind_Back(&rewind, Rewind_Length(&rewind) + 1, &game);
+    result.mismatches += !wrapped + !droppedEarly;
+    Rewind_Free(&rewind);
+    return result;
+}
+
+static void printUsage(const char* program)
+{
+    fprintf(stderr, "usage: %s [--threads N] [--json]\n", program);
+}
+
+int main(int argc, char** argv)
+{
+    int numThreads = Pool_DefaultWorkers();
+    int json = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = 1;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            numThreads = atoi(argv[++i]);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (numThreads < 1) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+#ifdef NDEBUG
+    const char* build = "release";
+#else
+    const char* build = "debug";
+#endif
+
+    PerftCount counts[NUM_PERFT_CASES];
+    double perftSeconds[NUM_PERFT_CASES];
+    int failures = 0;
+    for (size_t i = 0; i < NUM_PERFT_CASES; i++) {
+        const PerftCase* test = &PERFT_CASES[i];
+        perftSeconds[i] = runPerft(test, numThreads, &counts[i]);
+        if (counts[i].leaves != test->leaves || counts[i].lines != test->lines || counts[i].hash != test->hash)
+            failures++;
+    }
+
+    setupMicroInputs();
+    int batchMismatches[NUM_BATCH_KERNELS] = { 0 };
+    bool batchFailed = false;
+    for (int kernel = 0; kernel < NUM_BATCH_KERNELS; kernel++) {
+        if (BoardBatch_IsKernelSupported((BatchKernel)kernel)) {
+            batchMismatches[kernel] = checkBatchKernel((BatchKernel)kernel);
+            batchFailed |= batchMismatches[kernel] > 0;
+        }
+    }
+
+    const int featureMismatches = checkFeatures();
+    setupFeatureInputs();
+    const int zobristMismatches = checkZobrist();
+    CheckResult checks[4];
+    size_t numChecks = 0;
+    checks[numChecks++] = checkAllocations();
+    checks[numChecks++] = checkInput();
+    checks[numChecks++] = checkReplay();
+    checks[numChecks++] = checkRewind();
+    bool checkFailed = false;
+    for (size_t i = 0; i < numChecks; i++)
+        checkFailed |= checks[i].mismatches > 0;
+
+    MicroResult micro[8 + NUM_BATCH_KERNELS];
+    size_t numMicro = 0;
+    micro[numMicro++] = benchBlockFits();
+    micro[numMicro++] = benchClearFullRows();
+    micro[numMicro++] = benchUpdateShadowBlock();
+    micro[numMicro++] = benchGetCellPositions();
+    micro[numMicro++] = benchDrop();
+    for (int kernel = 0; kernel < NUM_BATCH_KERNELS; kernel++) {
+        if (BoardBatch_IsKernelSupported((BatchKernel)kernel))
+            micro[numMicro++] = benchBatchDrop((BatchKernel)kernel);
+    }
+    micro[numMicro++] = benchFeaturesFromScratch();
+    micro[numMicro++] = benchFeaturesDelta();
+    TranspositionStats tableStats;
+    micro[numMicro++] = benchTable(&tableStats);
+
+    if (json) {
+        printf("{\n  \"build\": \"%s\",\n  \"threads\": %d,\n  \"perft\": [\n", build, numThreads);
+        for (size_t i = 0; i < NUM_PERFT_CASES; i++) {
+            const PerftCase* test = &PERFT_CASES[i];
+            const PerftCount* count = &counts[i];
+            printf("    { \"name\": \"%s\", \"depth\": %d, \"nodes\": %llu, \"leaves\": %llu, \"lines\": %llu, "
+                   "\"hash\": \"%016llx\", \"seconds\": %.6f, \"nodes_per_second\": %.0f, \"ok\": %s }%s\n",
+                test->name, test->depth, (unsigned long long)count->nodes, (unsigned long long)count->leaves,
+                (unsigned long long)count->lines, (unsigned long long)count->hash, perftSeconds[i],
+                (double)count->nodes / perftSeconds[i],
+                count->leaves == test->leaves && count->lines == test->lines && count->hash == test->hash ? "true"
+                                                                                                        : "false",
+                i + 1 < NUM_PERFT_CASES ? "," : "");
+        }
+        printf("  ],\n  \"batch\": [\n");
+        for (int kernel = 0; kernel < NUM_BATCH_KERNELS; kernel++) {
+            printf("    { \"kernel\": \"%s\", \"supported\": %s, \"mismatches\": %d }%s\n",
+                BATCH_KERNEL_NAMES[kernel], BoardBatch_IsKernelSupported((BatchKernel)kernel) ? "true" : "false",
+                batchMismatches[kernel], kernel + 1 < NUM_BATCH_KERNELS ? "," : "");
+        }
+        printf("  ],\n  \"features\": { \"mismatches\": %d },\n", featureMismatches);
+        printf("  \"zobrist\": { \"mismatches\": %d },\n", zobristMismatches);
+        printf("  \"table\": { \"bytes\": %u, \"hits\": %llu, \"misses\": %llu, \"collisions\": %llu },\n",
+            TABLE_BENCH_BYTES, (unsigned long long)tableStats.hits, (unsigned long long)tableStats.misses,
+            (unsigned long long)tableStats.collisions);
+        printf("  \"checks\": [\n");
+        for (size_t i = 0; i < numChecks; i++) {
+            printf("    { \"name\": \"%s\", \"skipped\": %s, \"mismatches\": %d }%s\n", checks[i].name,
+                checks[i].skipped ? "true" : "false", checks[i].mismatches, i + 1 < numChecks ? "," : "");
+        }
+        printf("  ],\n  \"micro\": [\n");
+        for (size_t i = 0; i < numMicro; i++) {
+            printf("    { \"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.3f }%s\n", micro[i].name,
+                (unsigned long long)micro[i].iterations, 1e9 * micro[i].seconds / (double)micro[i].iterations,
+                i + 1 < numMicro ? "," : "");
+        }
+        printf("  ]\n}\n");
+    } else {
+        printf("build       %s, %d threads\n", build, numThreads);
+        printf("perft\n");
+        for (size_t i = 0; i < NUM_PERFT_CASES; i++) {
+            const PerftCase* test = &PERFT_CASES[i];
+            const PerftCount* count = &counts[i];
+            const int ok = count->leaves == test->leaves && count->lines == test->lines && count->hash == test->hash;
+            printf("  %-13s depth %d  leaves %-10llu %-8s %.3f s  %.2f M nodes/s\n", test->name, test->depth,
+                (unsigned long long)count->leaves, ok ? "ok" : "MISMATCH", perftSeconds[i],
+                (double)count->nodes / perftSeconds[i] / 1e6);
+        }
+        printf("batch\n");
+        for (int kernel = 0; kernel < NUM_BATCH_KERNELS; kernel++) {
+            if (!BoardBatch_IsKernelSupported((BatchKernel)kernel))
+                printf("  %-13s unsupported\n", BATCH_KERNEL_NAMES[kernel]);
+            else if (batchMismatches[kernel] == 0)
+                printf("  %-13s ok\n", BATCH_KERNEL_NAMES[kernel]);
+            else
+                printf("  %-13s MISMATCH (%d)\n", BATCH_KERNEL_NAMES[kernel], batchMismatches[kernel]);
+        }
+        printf("features\n");
+        if (featureMismatches == 0)
+            printf("  %-13s ok\n", "tracker");
+        else
+            printf("  %-13s MISMATCH (%d)\n", "tracker", featureMismatches);
+        printf("hashing\n");
+        if (zobristMismatches == 0)
+            printf("  %-13s ok\n", "zobrist");
+        else
+            printf("  %-13s MISMATCH (%d)\n", "zobrist", zobristMismatches);
+        printf("  %-13s %u MB, %llu hits, %llu misses, %llu collisions\n", "table", TABLE_BENCH_BYTES >> 20,
+            (unsigned long long)tableStats.hits, (unsigned long long)tableStats.misses,
+            (unsigned long long)tableStats.collisions);
+        printf("checks\n");
+        for (size_t i = 0; i < numChecks; i++) {
+            if (checks[i].skipped)
+                printf("  %-13s skipped\n", checks[i].name);
+            else if (checks[i].mismatches == 0)
+                printf("  %-13s ok\n", checks[i].name);
+            else
+                printf("  %-13s MISMATCH (%d)\n", checks[i].name, checks[i].mismatches);
+        }
+        printf("micro\n");
+        for (size_t i = 0; i < numMicro; i++) {
+            printf("  %-24s %8.2f ns/op\n", micro[i].name, 1e9 * micro[i].seconds / (double)micro[i].iterations);
+        }
+    }
+
+    if (batchFailed) {
+        fflush(stdout);
+        fprintf(stderr, "tetris-bench: a batch kernel disagrees with the one-board functions\n");
+    }
+    if (featureMismatches > 0) {
+        fflush(stdout);
+        fprintf(stderr, "tetris-bench: the feature tracker disagrees with the cell by cell features\n");
+    }
+    if (zobristMismatches > 0) {
+        fflush(stdout);
+        fprintf(stderr, "tetris-bench: the incremental Zobrist hash disagrees with the one from scratch\n");
+    }
+    for (size_t i = 0; i < numChecks; i++) {
+        if (checks[i].mismatches > 0) {
+            fflush(stdout);
+            fprintf(stderr, "tetris-bench: %s\n", checks[i].failure);
+        }
+    }
+    if (failures > 0) {
+        fflush(stdout);
+        fprintf(stderr, "tetris-bench: %d perft counts differ from the golden values; measured:\n", failures);
+        for (size_t i = 0; i < NUM_PERFT_CASES; i++) {
+            const PerftCase* test = &PERFT_CASES[i];
+            fprintf(stderr, "  %-13s %llu, %llu, 0x%016llxULL\n", test->name, (unsigned long long)counts[i].leaves,
+                (unsigned long long)counts[i].lines, (unsigned long long)counts[i].hash);
+        }
+        return 1;
+    }
+    return batchFailed || featureMismatches > 0 || zobristMismatches > 0 || checkFailed ? 1 : 0;
+}
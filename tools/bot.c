@@ -0,0 +1,527 @@
+// tetris-bot: plays games for a bot running in another process, so that
+// bots written in any language can be plugged in and benchmarked. The engine
+// talks to the bot over its own stdin/stdout, or with --exec over the pipes
+// of a child process it starts, one line per message.
+//
+// The engine starts with
+//
+//   hello 1 ROWS COLUMNS PREVIEW
+//
+// (1 is the protocol version) and then describes the first piece:
+//
+//   piece SEQ TYPE ROTATION ROW COLUMN NEXT QUEUE BOARD SCORE LINES
+//
+// SEQ is the number of pieces locked so far in this game. TYPE, NEXT and
+// every digit of QUEUE are block types 1-7 (Z S T L J I O); QUEUE holds the
+// PREVIEW pieces that come after NEXT, or "-" with no preview. ROTATION, ROW
+// and COLUMN place the current block's layout box as in src/core/block.c.
+// BOARD is one fixed-width hex mask per row, top row first, in which bit c
+// is set when column c is filled.
+//
+// The bot answers with commands, separated by newlines or ';':
+//
+//   place ROTATION ROW COLUMN   lock the block there; it must be a resting
+//                               position the block can reach
+//   drop ROTATION COLUMN        lock it where it lands when moved to that
+//                               rotation and column and dropped
+//   act MOVES                   L, R, U (rotate) and D (hard drop), as in
+//                               tetris-sim's scripts, as many as a line
+//                               (up to 64 KB) holds
+//   restart                     start the next game
+//   quit                        stop
+//
+// Every command gets exactly one reply, in order: the next piece line, an
+// "over SCORE LINES PIECES" line when the game has ended, "bye" when the
+// engine stops, or "error MESSAGE", in which case nothing changed. Replies
+// carry all the state, so a bot can batch several commands in one line and
+// send commands ahead without waiting for their replies. After an over line
+// the bot sends restart. The engine exits after the over line of the last
+// of --games games, or after the bye that answers quit or a restart that
+// ends the last game early.
+
+#include "core/tetris_core.h"
+#include "pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <errno.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#define BOT_PROTOCOL_VERSION 1
+#define BOT_MAX_PREVIEW 16
+#define BOT_BUFFER_SIZE 65536
+#define BOT_LINE_SIZE 256
+#define BOT_ROW_DIGITS ((BOARD_COLUMNS + 3) / 4)
+
+typedef struct
+{
+    int in;
+    int out;
+    char input[BOT_BUFFER_SIZE];
+    size_t inputLength;
+    char output[BOT_BUFFER_SIZE];
+    size_t outputLength;
+    bool open;
+    // Totals for the report
+    uint64_t bytesIn;
+    uint64_t bytesOut;
+    uint64_t commands;
+    double engineSeconds;
+
+} Channel;
+
+typedef struct
+{
+    GameConfig config;
+    Game game;
+    uint32_t preview;
+    uint32_t maxPieces;
+    uint32_t maxGames;
+    uint32_t games;
+    bool over;
+    // Totals over finished games
+    uint64_t pieces;
+    uint64_t lines;
+    uint64_t score;
+    uint32_t bestScore;
+
+} Session;
+
+static const Action MOVE_ACTIONS[] = { ['L'] = ACTION_MOVE_LEFT, ['R'] = ACTION_MOVE_RIGHT, ['U'] = ACTION_ROTATE,
+    ['D'] = ACTION_HARD_DROP };
+
+// Output
+
+static void flushOutput(Channel* channel)
+{
+    const char* text = channel->output;
+    size_t length = channel->outputLength;
+    while (length > 0 && channel->open) {
+        const long written = (long)write(channel->out, text, (unsigned)length);
+#ifndef _WIN32
+        if (written < 0 && errno == EINTR)
+            continue;
+#endif
+        if (written <= 0) {
+            channel->open = false;
+            break;
+        }
+        text += written;
+        length -= (size_t)written;
+    }
+    channel->bytesOut += channel->outputLength;
+    channel->outputLength = 0;
+}
+
+// Replies are buffered and only sent when the bot has nothing more queued,
+// so a pipelining bot gets them in large writes and a lockstep one at once.
+static void reply(Channel* channel, const char* text, size_t length)
+{
+    if (channel->outputLength + length > BOT_BUFFER_SIZE)
+        flushOutput(channel);
+    memcpy(channel->output + channel->outputLength, text, length);
+    channel->outputLength += length;
+}
+
+static void replyLine(Channel* channel, const char* text)
+{
+    reply(channel, text, strlen(text));
+}
+
+static void sendPiece(Channel* channel, const Session* session)
+{
+    static const char HEX[] = "0123456789abcdef";
+    const Game* game = &session->game;
+    const Block* block = &game->currentBlock;
+
+    char queue[BOT_MAX_PREVIEW + 1] = "-";
+    Randomizer upcoming = game->randomizer;
+    for (uint32_t i = 0; i < session->preview; i++)
+        queue[i] = (char)('0' + Randomizer_Next(&upcoming));
+    if (session->preview > 0)
+        queue[session->preview] = '\0';
+
+    char board[BOARD_ROWS * BOT_ROW_DIGITS + 1];
+    char* digit = board;
+    for (int row = 0; row < BOARD_ROWS; row++) {
+        for (int shift = (BOT_ROW_DIGITS - 1) * 4; shift >= 0; shift -= 4)
+            *digit++ = HEX[(game->board.rows[row] >> shift) & 0xf];
+    }
+    *digit = '\0';
+
+    char line[BOT_LINE_SIZE];
+    const int length = snprintf(line, sizeof(line), "piece %u %u %d %d %d %u %s %s %u %u\n", game->pieces, block->id,
+        block->rotationState, block->rowOffset, block->columnOffset, game->nextBlock.id, queue, board, game->score,
+        game->lines);
+    reply(channel, line, (size_t)length);
+}
+
+static void sendOver(Channel* channel, const Session* session)
+{
+    char line[BOT_LINE_SIZE];
+    snprintf(line, sizeof(line), "over %u %u %u\n", session->game.score, session->game.lines, session->game.pieces);
+    replyLine(channel, line);
+}
+
+// Games
+
+static void startGame(Session* session)
+{
+    GameConfig config = session->config;
+    config.seed += session->games;
+    Game_Init(&session->game, &config);
+    session->over = false;
+}
+
+static void endGame(Session* session)
+{
+    const Game* game = &session->game;
+    session->pieces += game->pieces;
+    session->lines += game->lines;
+    session->score += game->score;
+    if (game->score > session->bestScore)
+        session->bestScore = game->score;
+    session->games++;
+    session->over = true;
+}
+
+static bool sameCells(const Block* a, const Block* b)
+{
+    Position cellsA[NUM_BLOCK_CELLS];
+    Position cellsB[NUM_BLOCK_CELLS];
+    size_t countA;
+    size_t countB;
+    Block_GetCellPositions(a, cellsA, &countA);
+    Block_GetCellPositions(b, cellsB, &countB);
+    for (size_t i = 0; i < countA; i++) {
+        bool found = false;
+        for (size_t k = 0; k < countB && !found; k++)
+            found = cellsA[i].row == cellsB[k].row && cellsA[i].column == cellsB[k].column;
+        if (!found)
+            return false;
+    }
+    return countA == countB;
+}
+
+// Locks the current block at target if it covers the same cells as one of
+// the move generator's placements, so a bot can't reach anywhere the keys
+// couldn't.
+static bool placeBlock(Game* game, const Block* target)
+{
+    Placement placements[MOVEGEN_MAX_PLACEMENTS];
+    if (target->rotationState < 0 || target->rotationState >= target->numRotations
+        || !Board_CanPlace(&game->board, target))
+        return false;
+
+    const size_t count = MoveGen_Placements(&game->board, &game->currentBlock, placements);
+    for (size_t i = 0; i < count; i++) {
+        Block block = game->currentBlock;
+        block.rotationState = placements[i].rotation;
+        block.rowOffset = placements[i].row;
+        block.columnOffset = placements[i].column;
+        if (sameCells(&block, target)) {
+            Game_ApplyPlacement(game, &placements[i]);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Runs one command and queues its reply. Returns false on quit.
+static bool runCommand(Channel* channel, Session* session, char* command)
+{
+    char name[16];
+    int consumed = 0;
+    if (sscanf(command, "%15s%n", name, &consumed) != 1)
+        return true;
+    const char* arguments = command + consumed;
+    Game* game = &session->game;
+    channel->commands++;
+
+    if (strcmp(name, "quit") == 0) {
+        replyLine(channel, "bye\n");
+        return false;
+    }
+    if (strcmp(name, "restart") == 0) {
+        if (!session->over)
+            endGame(session);
+        if (session->maxGames > 0 && session->games >= session->maxGames) {
+            replyLine(channel, "bye\n");
+            return false;
+        }
+        startGame(session);
+        sendPiece(channel, session);
+        return true;
+    }
+    if (session->over) {
+        replyLine(channel, "error game over\n");
+        return true;
+    }
+
+    if (strcmp(name, "place") == 0 || strcmp(name, "drop") == 0) {
+        const bool drop = name[0] == 'd';
+        int rotation;
+        int row = 0;
+        int column;
+        const int parsed = drop ? sscanf(arguments, "%d %d", &rotation, &column)
+                                : sscanf(arguments, "%d %d %d", &rotation, &row, &column);
+        if (parsed != (drop ? 2 : 3) || rotation < INT8_MIN || rotation > INT8_MAX || row < INT8_MIN
+            || row > INT8_MAX || column < INT8_MIN || column > INT8_MAX) {
+            replyLine(channel, "error bad arguments\n");
+            return true;
+        }
+        Block target = game->currentBlock;
+        target.rotationState = (int8_t)rotation;
+        target.columnOffset = (int8_t)column;
+        if (drop) {
+            // Some rotations only fit once the block is below the spawn row
+            if (rotation < 0 || rotation >= target.numRotations) {
+                replyLine(channel, "error bad arguments\n");
+                return true;
+            }
+            while (target.rowOffset < BOARD_ROWS && !Board_CanPlace(&game->board, &target))
+                target.rowOffset++;
+            if (target.rowOffset == BOARD_ROWS) {
+                replyLine(channel, "error unreachable\n");
+                return true;
+            }
+            target.rowOffset = Board_DropRow(&game->board, &target);
+        } else {
+            target.rowOffset = (int8_t)row;
+        }
+        if (!placeBlock(game, &target)) {
+            replyLine(channel, "error unreachable\n");
+            return true;
+        }
+    } else if (strcmp(name, "act") == 0) {
+        // As long as the line, which can fill the whole input buffer
+        const char* moves = arguments + strspn(arguments, " \t");
+        const size_t length = strcspn(moves, " \t");
+        if (length == 0 || strspn(moves, "LRUD") < length) {
+            replyLine(channel, "error bad arguments\n");
+            return true;
+        }
+        for (size_t i = 0; i < length && !game->gameOver; i++)
+            Game_Apply(game, MOVE_ACTIONS[(unsigned char)moves[i]]);
+    } else {
+        replyLine(channel, "error unknown command\n");
+        return true;
+    }
+
+    if (game->gameOver || (session->maxPieces > 0 && game->pieces >= session->maxPieces)) {
+        endGame(session);
+        sendOver(channel, session);
+        return session->maxGames == 0 || session->games < session->maxGames;
+    }
+    sendPiece(channel, session);
+    return true;
+}
+
+// Runs every complete line in the input buffer; returns false on quit.
+static bool runLines(Channel* channel, Session* session)
+{
+    size_t start = 0;
+    for (;;) {
+        char* end = memchr(channel->input + start, '\n', channel->inputLength - start);
+        if (!end)
+            break;
+        *end = '\0';
+        char* line = channel->input + start;
+        start = (size_t)(end + 1 - channel->input);
+
+        char* next;
+        for (char* command = line; command; command = next) {
+            next = strchr(command, ';');
+            if (next)
+                *next++ = '\0';
+            // Tolerates CRLF line ends
+            command[strcspn(command, "\r")] = '\0';
+            if (!runCommand(channel, session, command))
+                return false;
+        }
+    }
+
+    memmove(channel->input, channel->input + start, channel->inputLength - start);
+    channel->inputLength -= start;
+    if (channel->inputLength == BOT_BUFFER_SIZE) {
+        // A line that fills the buffer can never finish
+        replyLine(channel, "error line too long\n");
+        channel->inputLength = 0;
+    }
+    return true;
+}
+
+// Waits for more input; returns false at the end of it.
+static bool readInput(Channel* channel)
+{
+    long received;
+    do {
+        received = (long)read(channel->in, channel->input + channel->inputLength,
+            (unsigned)(BOT_BUFFER_SIZE - channel->inputLength));
+#ifndef _WIN32
+    } while (received < 0 && errno == EINTR);
+#else
+    } while (0);
+#endif
+    if (received <= 0)
+        return false;
+    channel->inputLength += (size_t)received;
+    channel->bytesIn += (uint64_t)received;
+    return true;
+}
+
+#ifndef _WIN32
+// Starts command under the shell with its stdin and stdout connected to
+// channel.
+static bool startBot(Channel* channel, const char* command, pid_t* child)
+{
+    int toBot[2];
+    int fromBot[2];
+    if (pipe(toBot) != 0)
+        return false;
+    if (pipe(fromBot) != 0) {
+        close(toBot[0]);
+        close(toBot[1]);
+        return false;
+    }
+    *child = fork();
+    if (*child < 0) {
+        close(toBot[0]);
+        close(toBot[1]);
+        close(fromBot[0]);
+        close(fromBot[1]);
+        return false;
+    }
+    if (*child == 0) {
+        dup2(toBot[0], STDIN_FILENO);
+        dup2(fromBot[1], STDOUT_FILENO);
+        close(toBot[0]);
+        close(toBot[1]);
+        close(fromBot[0]);
+        close(fromBot[1]);
+        execl("/bin/sh", "sh", "-c", command, (char*)NULL);
+        _exit(127);
+    }
+    close(toBot[0]);
+    close(fromBot[1]);
+    channel->out = toBot[1];
+    channel->in = fromBot[0];
+    return true;
+}
+#endif
+
+static void printReport(const Session* session, const Channel* channel, double seconds)
+{
+    const double pieces = (double)session->pieces;
+    fprintf(stderr, "games       %u in %.3f s\n", session->games, seconds);
+    fprintf(stderr, "throughput  %.0f pieces/s, %llu commands\n", pieces / seconds,
+        (unsigned long long)channel->commands);
+    if (session->games > 0) {
+        fprintf(stderr, "score       mean %.2f  max %u, %.2f lines and %.1f pieces per game\n",
+            (double)session->score / session->games, session->bestScore, (double)session->lines / session->games,
+            pieces / session->games);
+    }
+    if (session->pieces > 0) {
+        // Parsing commands, running them and formatting replies, but not the
+        // I/O, which also pays for the bot's time on a busy machine
+        fprintf(stderr, "engine      %.2f us per piece, %.0f bytes in and %.0f out per piece\n",
+            channel->engineSeconds / pieces * 1e6, (double)channel->bytesIn / pieces,
+            (double)channel->bytesOut / pieces);
+    }
+}
+
+static void printUsage(const char* program)
+{
+    fprintf(stderr,
+        "usage: %s [--exec COMMAND] [--games N] [--max-pieces N] [--preview N] [--seed N] [--bag]\n", program);
+}
+
+int main(int argc, char** argv)
+{
+    static Channel channel;
+    Session session;
+    memset(&session, 0, sizeof(session));
+    session.config = Game_DefaultConfig(1);
+    session.preview = 5;
+    session.maxGames = 1;
+    const char* command = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--exec") == 0 && i + 1 < argc) {
+            command = argv[++i];
+        } else if (strcmp(argv[i], "--games") == 0 && i + 1 < argc) {
+            session.maxGames = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--max-pieces") == 0 && i + 1 < argc) {
+            session.maxPieces = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--preview") == 0 && i + 1 < argc) {
+            session.preview = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            session.config.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--bag") == 0) {
+            session.config.randomizer = RANDOMIZER_BAG;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (session.preview > BOT_MAX_PREVIEW) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    channel.in = 0;
+    channel.out = 1;
+    channel.open = true;
+#ifdef _WIN32
+    if (command) {
+        fprintf(stderr, "tetris-bot: --exec is not supported on Windows\n");
+        return 1;
+    }
+#else
+    // A bot that exits early ends the run rather than killing the engine
+    signal(SIGPIPE, SIG_IGN);
+    pid_t child = -1;
+    if (command && !startBot(&channel, command, &child)) {
+        fprintf(stderr, "tetris-bot: cannot start %s\n", command);
+        return 1;
+    }
+#endif
+
+    char hello[BOT_LINE_SIZE];
+    snprintf(hello, sizeof(hello), "hello %d %d %d %u\n", BOT_PROTOCOL_VERSION, BOARD_ROWS, BOARD_COLUMNS,
+        session.preview);
+    replyLine(&channel, hello);
+    startGame(&session);
+    sendPiece(&channel, &session);
+
+    const double start = Pool_Now();
+    for (;;) {
+        flushOutput(&channel);
+        if (!channel.open || !readInput(&channel))
+            break;
+        const double runStart = Pool_Now();
+        const bool running = runLines(&channel, &session);
+        channel.engineSeconds += Pool_Now() - runStart;
+        if (!running)
+            break;
+    }
+    flushOutput(&channel);
+    const double seconds = Pool_Now() - start;
+    if (!session.over)
+        endGame(&session);
+
+#ifndef _WIN32
+    if (command) {
+        close(channel.out);
+        close(channel.in);
+        waitpid(child, NULL, 0);
+    }
+#endif
+    printReport(&session, &channel, seconds);
+    return 0;
+}
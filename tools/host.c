@@ -0,0 +1,840 @@
+// tetris-host: hosts many independent game sessions in one process and
+// advances them all together, one tick at a time, on a fixed set of worker
+// threads. Sessions are sharded by id across the workers, each of which owns
+// a contiguous array of them, so a tick is one pass over memory per core.
+//
+// Clients talk to the host over stdin/stdout or a Unix socket, one command
+// per line:
+//
+//   new [SEED]      start a session; the host answers "new ID"
+//   act ID MOVES    queue moves for the next tick, as L, R, U (rotate) and
+//                   D (drop) like tetris-sim's scripts
+//   restart ID      queue a restart
+//   wait TICKS      read nothing more from this client for that many ticks
+//   quit            disconnect
+//
+// Queued moves are the session's inbox. After each tick the host sends every
+// session that changed a line with only what changed since the last one:
+//
+//   state ID TICK [block TYPE ROW COLUMN ROTATION] [next TYPE]
+//         [score SCORE LINES] [row ROW CELLS]... [over | playing]
+//
+// where CELLS is one digit (the block type, 0 for empty) per column. The
+// first line of a session has everything but the empty rows. A line the host
+// has no memory for is dropped, and the next one has everything.
+// --bench SESSIONS instead fills the host with that many random bots and
+// reports tick latency percentiles and the cost of a session tick.
+
+#include "core/tetris_core.h"
+#include "pool.h"
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifndef _WIN32
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#define HOST_INBOX_SIZE 32
+#define HOST_MAX_CLIENTS 256
+#define HOST_LINE_SIZE 256
+#define HOST_LATENCY_SAMPLES 65536
+#define HOST_NO_CLIENT (-1)
+#define HOST_NO_SLOT SIZE_MAX
+
+// A session belongs to the client in slot client for as long as that slot's
+// generation stays clientGeneration, so a reused slot never inherits the
+// sessions of the client before it. Free sessions are chained through
+// nextFree for reuse.
+typedef struct
+{
+    Game game;
+    Action inbox[HOST_INBOX_SIZE];
+    uint8_t inboxCount;
+    bool inUse;
+    int client;
+    uint32_t clientGeneration;
+    size_t nextFree;
+    // What the client was last sent
+    Block sentBlock;
+    uint8_t sentNext;
+    uint32_t sentScore;
+    uint32_t sentRevision;
+    uint8_t sentGrid[BOARD_ROWS][BOARD_COLUMNS];
+    bool sentGameOver;
+    bool sentAny;
+    // The last line did not fit in memory, so the next has everything
+    bool resend;
+    // Where this tick's outbox line is in the shard's output
+    size_t outputStart;
+    size_t outputLength;
+
+} Session;
+
+typedef struct
+{
+    Session* sessions;
+    size_t count;
+    size_t capacity;
+    size_t freeHead;
+    char* output;
+    size_t outputLength;
+    size_t outputCapacity;
+
+} Shard;
+
+typedef struct
+{
+    int in;
+    int out;
+    char line[HOST_LINE_SIZE];
+    size_t lineLength;
+    uint32_t waitUntil;
+    uint32_t generation;
+    // A slot stays in use after its client has gone until its sessions are
+    // freed between ticks
+    bool inUse;
+    bool open;
+
+} Client;
+
+typedef struct
+{
+    Shard* shards;
+    int numWorkers;
+    size_t numSessions;
+    uint64_t sessionsCreated;
+    int nextShard;
+    uint32_t tick;
+    GameConfig config;
+    Client clients[HOST_MAX_CLIENTS];
+    int numClients;
+    int listener;
+    // Workers start a tick when generation moves on and report back
+    // through pending
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    uint64_t generation;
+    int pending;
+    bool quit;
+    double* latencies;
+    uint64_t numLatencies;
+
+} Host;
+
+typedef struct
+{
+    Host* host;
+    int worker;
+
+} Worker;
+
+static const Action MOVE_ACTIONS[] = { ['L'] = ACTION_MOVE_LEFT, ['R'] = ACTION_MOVE_RIGHT, ['U'] = ACTION_ROTATE,
+    ['D'] = ACTION_HARD_DROP };
+
+// Output
+
+// Returns false, having appended nothing, when the output can't grow.
+static bool append(Shard* shard, const char* format, ...)
+{
+    for (;;) {
+        va_list args;
+        va_start(args, format);
+        const size_t room = shard->outputCapacity - shard->outputLength;
+        const int length = vsnprintf(shard->output + shard->outputLength, room, format, args);
+        va_end(args);
+        if (length < 0)
+            return false;
+        if ((size_t)length < room) {
+            shard->outputLength += (size_t)length;
+            return true;
+        }
+        const size_t capacity = shard->outputCapacity ? shard->outputCapacity * 2 : 4096;
+        char* grown = realloc(shard->output, capacity);
+        if (!grown)
+            return false;
+        shard->output = grown;
+        shard->outputCapacity = capacity;
+    }
+}
+
+// Appends the session's delta line, if anything changed, and remembers what
+// was sent. A line that runs out of memory is dropped whole, and the next
+// one sends everything, empty rows included.
+static void writeDelta(Shard* shard, Session* session, size_t id, uint32_t tick)
+{
+    const Game* game = &session->game;
+    const size_t start = shard->outputLength;
+    const bool first = !session->sentAny || session->resend;
+    bool changed = false;
+    bool ok = true;
+
+    if (first || memcmp(&game->currentBlock, &session->sentBlock, sizeof(Block)) != 0) {
+        const Block* block = &game->currentBlock;
+        ok &= append(shard, "state %zu %u block %u %d %d %d", id, tick, block->id, block->rowOffset,
+            block->columnOffset, block->rotationState);
+        session->sentBlock = *block;
+        changed = true;
+    }
+    if (first || game->nextBlock.id != session->sentNext) {
+        if (!changed)
+            ok &= append(shard, "state %zu %u", id, tick);
+        ok &= append(shard, " next %u", game->nextBlock.id);
+        session->sentNext = game->nextBlock.id;
+        changed = true;
+    }
+    if (first || game->score != session->sentScore) {
+        if (!changed)
+            ok &= append(shard, "state %zu %u", id, tick);
+        ok &= append(shard, " score %u %u", game->score, game->lines);
+        session->sentScore = game->score;
+        changed = true;
+    }
+    if (first || game->board.revision != session->sentRevision) {
+        for (int row = 0; row < BOARD_ROWS; row++) {
+            // The sent grid starts out empty, so the first line skips empty rows
+            if (!session->resend && memcmp(game->board.grid[row], session->sentGrid[row], BOARD_COLUMNS) == 0)
+                continue;
+            if (!changed)
+                ok &= append(shard, "state %zu %u", id, tick);
+            char cells[BOARD_COLUMNS + 1];
+            for (int column = 0; column < BOARD_COLUMNS; column++)
+                cells[column] = (char)('0' + game->board.grid[row][column]);
+            cells[BOARD_COLUMNS] = '\0';
+            ok &= append(shard, " row %d %s", row, cells);
+            changed = true;
+        }
+        memcpy(session->sentGrid, game->board.grid, sizeof(session->sentGrid));
+        session->sentRevision = game->board.revision;
+    }
+    if (first || game->gameOver != session->sentGameOver) {
+        if (!changed)
+            ok &= append(shard, "state %zu %u", id, tick);
+        ok &= append(shard, game->gameOver ? " over" : " playing");
+        session->sentGameOver = game->gameOver;
+        changed = true;
+    }
+    if (changed)
+        ok &= append(shard, "\n");
+
+    session->sentAny = true;
+    session->resend = !ok;
+    if (!ok)
+        shard->outputLength = start;
+    session->outputStart = start;
+    session->outputLength = shard->outputLength - start;
+}
+
+// Workers
+
+static void runShard(Host* host, int worker)
+{
+    Shard* shard = &host->shards[worker];
+    shard->outputLength = 0;
+    for (size_t i = 0; i < shard->count; i++) {
+        Session* session = &shard->sessions[i];
+        // Clients only come and go between ticks, and their sessions stop
+        // when they do
+        if (!session->inUse || (session->client != HOST_NO_CLIENT && !host->clients[session->client].open)) {
+            session->outputLength = 0;
+            continue;
+        }
+        for (uint8_t k = 0; k < session->inboxCount; k++)
+            Game_Apply(&session->game, session->inbox[k]);
+        session->inboxCount = 0;
+        Game_Advance(&session->game);
+        writeDelta(shard, session, i * (size_t)host->numWorkers + (size_t)worker, host->tick);
+    }
+}
+
+static void* workerMain(void* context)
+{
+    const Worker* self = context;
+    Host* host = self->host;
+    uint64_t seen = 0;
+    for (;;) {
+        pthread_mutex_lock(&host->lock);
+        while (host->generation == seen && !host->quit)
+            pthread_cond_wait(&host->start, &host->lock);
+        const bool quit = host->quit;
+        seen = host->generation;
+        pthread_mutex_unlock(&host->lock);
+        if (quit)
+            return NULL;
+
+        runShard(host, self->worker);
+
+        pthread_mutex_lock(&host->lock);
+        if (--host->pending == 0)
+            pthread_cond_signal(&host->done);
+        pthread_mutex_unlock(&host->lock);
+    }
+}
+
+static void runTick(Host* host)
+{
+    pthread_mutex_lock(&host->lock);
+    host->pending = host->numWorkers;
+    host->generation++;
+    pthread_cond_broadcast(&host->start);
+    while (host->pending > 0)
+        pthread_cond_wait(&host->done, &host->lock);
+    pthread_mutex_unlock(&host->lock);
+    host->tick++;
+}
+
+// Sessions
+
+// Session ids are slot * numWorkers + shard.
+static Session* findSession(Host* host, size_t id)
+{
+    Shard* shard = &host->shards[id % (size_t)host->numWorkers];
+    const size_t slot = id / (size_t)host->numWorkers;
+    if (slot >= shard->count || !shard->sessions[slot].inUse)
+        return NULL;
+    return &shard->sessions[slot];
+}
+
+static bool ownsSession(const Host* host, const Session* session, int clientIndex)
+{
+    return session->client == clientIndex && session->clientGeneration == host->clients[clientIndex].generation;
+}
+
+// Shards take new sessions in turn, reusing free slots before growing.
+static bool newSession(Host* host, uint64_t seed, int client, size_t* id)
+{
+    const int worker = host->nextShard;
+    Shard* shard = &host->shards[worker];
+    size_t slot = shard->freeHead;
+    if (slot != HOST_NO_SLOT) {
+        shard->freeHead = shard->sessions[slot].nextFree;
+    } else {
+        if (shard->count == shard->capacity) {
+            const size_t capacity = shard->capacity ? shard->capacity * 2 : 64;
+            Session* grown = realloc(shard->sessions, capacity * sizeof(Session));
+            if (!grown)
+                return false;
+            shard->sessions = grown;
+            shard->capacity = capacity;
+        }
+        slot = shard->count++;
+    }
+    host->nextShard = (worker + 1) % host->numWorkers;
+
+    Session* session = &shard->sessions[slot];
+    memset(session, 0, sizeof(*session));
+    GameConfig config = host->config;
+    config.seed = seed;
+    Game_Init(&session->game, &config);
+    session->inUse = true;
+    session->client = client;
+    session->clientGeneration = client == HOST_NO_CLIENT ? 0 : host->clients[client].generation;
+    host->numSessions++;
+    host->sessionsCreated++;
+    *id = slot * (size_t)host->numWorkers + (size_t)worker;
+    return true;
+}
+
+static void freeSession(Host* host, Shard* shard, size_t slot)
+{
+    shard->sessions[slot].inUse = false;
+    shard->sessions[slot].nextFree = shard->freeHead;
+    shard->freeHead = slot;
+    host->numSessions--;
+}
+
+static bool queueAction(Session* session, Action action)
+{
+    if (session->inboxCount == HOST_INBOX_SIZE)
+        return false;
+    session->inbox[session->inboxCount++] = action;
+    return true;
+}
+
+// Clients
+
+static void sendText(Client* client, const char* text, size_t length)
+{
+#ifndef _WIN32
+    while (length > 0 && client->open) {
+        const ssize_t written = write(client->out, text, length);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0) {
+            client->open = false;
+            break;
+        }
+        text += written;
+        length -= (size_t)written;
+    }
+#else
+    (void)client;
+    fwrite(text, 1, length, stdout);
+    fflush(stdout);
+#endif
+}
+
+// The slot and its sessions are freed by reapClients, between ticks.
+static void disconnect(Client* client)
+{
+    client->open = false;
+}
+
+// Frees the slots of the clients that have gone, and their sessions.
+static void reapClients(Host* host)
+{
+    for (int i = 0; i < host->numClients; i++) {
+        Client* client = &host->clients[i];
+        if (!client->inUse || client->open)
+            continue;
+        for (int worker = 0; worker < host->numWorkers; worker++) {
+            Shard* shard = &host->shards[worker];
+            for (size_t slot = 0; slot < shard->count; slot++) {
+                if (shard->sessions[slot].inUse && ownsSession(host, &shard->sessions[slot], i))
+                    freeSession(host, shard, slot);
+            }
+        }
+#ifndef _WIN32
+        if (client->in > STDERR_FILENO)
+            close(client->in);
+        if (client->out > STDERR_FILENO && client->out != client->in)
+            close(client->out);
+#endif
+        client->inUse = false;
+    }
+}
+
+static void reply(Client* client, const char* text)
+{
+    sendText(client, text, strlen(text));
+}
+
+static void runCommand(Host* host, int clientIndex, char* line)
+{
+    Client* client = &host->clients[clientIndex];
+    char command[16];
+    int consumed = 0;
+    if (sscanf(line, "%15s%n", command, &consumed) != 1)
+        return;
+    const char* arguments = line + consumed;
+    char text[HOST_LINE_SIZE];
+
+    if (strcmp(command, "new") == 0) {
+        unsigned long long seed = (unsigned long long)host->sessionsCreated + host->config.seed;
+        sscanf(arguments, "%llu", &seed);
+        size_t id;
+        if (!newSession(host, seed, clientIndex, &id)) {
+            reply(client, "error out of memory\n");
+            return;
+        }
+        snprintf(text, sizeof(text), "new %zu\n", id);
+        reply(client, text);
+    } else if (strcmp(command, "act") == 0 || strcmp(command, "restart") == 0) {
+        size_t id;
+        char moves[HOST_LINE_SIZE] = "";
+        const bool restart = command[0] == 'r';
+        if (sscanf(arguments, "%zu %255s", &id, moves) < (restart ? 1 : 2)) {
+            reply(client, "error bad arguments\n");
+            return;
+        }
+        Session* session = findSession(host, id);
+        if (!session || !ownsSession(host, session, clientIndex)) {
+            reply(client, "error no such session\n");
+            return;
+        }
+        if (restart) {
+            if (!queueAction(session, ACTION_RESTART)) {
+                snprintf(text, sizeof(text), "error %zu inbox full\n", id);
+                reply(client, text);
+            }
+            return;
+        }
+        for (const char* move = moves; *move; move++) {
+            const unsigned char letter = (unsigned char)*move;
+            const Action action = letter < sizeof(MOVE_ACTIONS) / sizeof(MOVE_ACTIONS[0]) ? MOVE_ACTIONS[letter]
+                                                                                       : ACTION_NONE;
+            if (action == ACTION_NONE || !queueAction(session, action)) {
+                snprintf(text, sizeof(text), "error %zu %s\n", id,
+                    action == ACTION_NONE ? "unknown move" : "inbox full");
+                reply(client, text);
+                return;
+            }
+        }
+    } else if (strcmp(command, "wait") == 0) {
+        unsigned long ticks = 0;
+        sscanf(arguments, "%lu", &ticks);
+        client->waitUntil = host->tick + (uint32_t)ticks;
+    } else if (strcmp(command, "quit") == 0) {
+        disconnect(client);
+    } else {
+        reply(client, "error unknown command\n");
+    }
+}
+
+// Runs every complete line in the client's buffer, up to the first wait.
+static void runLines(Host* host, int clientIndex)
+{
+    Client* client = &host->clients[clientIndex];
+    while (client->open && client->waitUntil <= host->tick) {
+        char* end = memchr(client->line, '\n', client->lineLength);
+        if (!end) {
+            // A line that fills the buffer can never finish
+            if (client->lineLength == HOST_LINE_SIZE) {
+                reply(client, "error line too long\n");
+                client->lineLength = 0;
+            }
+            return;
+        }
+        *end = '\0';
+        runCommand(host, clientIndex, client->line);
+        const size_t used = (size_t)(end + 1 - client->line);
+        memmove(client->line, end + 1, client->lineLength - used);
+        client->lineLength -= used;
+    }
+}
+
+#ifndef _WIN32
+// Takes the first free slot, bumping its generation so that it owns none of
+// the sessions of the client before it.
+static bool addClient(Host* host, int in, int out)
+{
+    int index = 0;
+    while (index < host->numClients && host->clients[index].inUse)
+        index++;
+    if (index == HOST_MAX_CLIENTS)
+        return false;
+    if (index == host->numClients)
+        host->numClients++;
+
+    Client* client = &host->clients[index];
+    const uint32_t generation = client->generation + 1;
+    *client = (Client) { .in = in, .out = out, .generation = generation, .inUse = true, .open = true };
+    return true;
+}
+
+static int openSocket(const char* path)
+{
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path))
+        return -1;
+    strcpy(address.sun_path, path);
+
+    const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0)
+        return -1;
+    unlink(path);
+    if (bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 16) != 0) {
+        close(listener);
+        return -1;
+    }
+    return listener;
+}
+
+// Reads whatever the clients have sent, waiting at most timeout seconds for
+// the first of it, and accepts new connections.
+static void pollClients(Host* host, double timeout)
+{
+    struct pollfd fds[HOST_MAX_CLIENTS + 1];
+    int owners[HOST_MAX_CLIENTS + 1];
+    nfds_t count = 0;
+    for (int i = 0; i < host->numClients; i++) {
+        const Client* client = &host->clients[i];
+        // Clients are read only once their queued lines are used up and any
+        // wait is over, so that what they sent stays queued, and a closed
+        // stream is only noticed after its last command has run
+        if (client->open && client->waitUntil <= host->tick && !memchr(client->line, '\n', client->lineLength)
+            && client->lineLength < HOST_LINE_SIZE) {
+            fds[count] = (struct pollfd) { .fd = client->in, .events = POLLIN };
+            owners[count++] = i;
+        }
+    }
+    if (host->listener >= 0) {
+        fds[count] = (struct pollfd) { .fd = host->listener, .events = POLLIN };
+        owners[count++] = -1;
+    }
+    // With nothing to watch this just sleeps
+    if (poll(fds, count, timeout > 0 ? (int)(timeout * 1000 + 0.999) : 0) <= 0)
+        return;
+
+    for (nfds_t k = 0; k < count; k++) {
+        if (!(fds[k].revents & (POLLIN | POLLHUP | POLLERR)))
+            continue;
+        if (owners[k] < 0) {
+            const int connection = accept(host->listener, NULL, NULL);
+            if (connection >= 0 && !addClient(host, connection, connection))
+                close(connection);
+            continue;
+        }
+        Client* client = &host->clients[owners[k]];
+        const ssize_t received
+            = read(client->in, client->line + client->lineLength, HOST_LINE_SIZE - client->lineLength);
+        if (received <= 0 && !(received < 0 && errno == EINTR))
+            disconnect(client);
+        else if (received > 0)
+            client->lineLength += (size_t)received;
+    }
+}
+#endif
+
+// Sends each client the lines of the sessions it owns.
+static void sendOutboxes(Host* host)
+{
+    for (int worker = 0; worker < host->numWorkers; worker++) {
+        const Shard* shard = &host->shards[worker];
+        for (size_t i = 0; i < shard->count; i++) {
+            const Session* session = &shard->sessions[i];
+            if (session->outputLength > 0 && session->client != HOST_NO_CLIENT)
+                sendText(&host->clients[session->client], shard->output + session->outputStart,
+                    session->outputLength);
+        }
+    }
+}
+
+static bool anyClientOpen(const Host* host)
+{
+    for (int i = 0; i < host->numClients; i++) {
+        if (host->clients[i].open)
+            return true;
+    }
+    return false;
+}
+
+// Bench bots: each session gets a random move every few ticks on average
+// and restarts when its game ends.
+static void feedBots(Host* host, uint64_t* state)
+{
+    for (int worker = 0; worker < host->numWorkers; worker++) {
+        const Shard* shard = &host->shards[worker];
+        for (size_t slot = 0; slot < shard->count; slot++) {
+            Session* session = &shard->sessions[slot];
+            if (!session->inUse)
+                continue;
+            if (session->game.gameOver) {
+                queueAction(session, ACTION_RESTART);
+                continue;
+            }
+            *state ^= *state << 13;
+            *state ^= *state >> 7;
+            *state ^= *state << 17;
+            if ((*state & 7) == 0)
+                queueAction(session, (Action)(ACTION_MOVE_LEFT + (*state >> 3) % 4));
+        }
+    }
+}
+
+static int compareDoubles(const void* a, const void* b)
+{
+    const double x = *(const double*)a;
+    const double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void printReport(const Host* host, double seconds, uint64_t lateTicks)
+{
+    const size_t count = host->numLatencies < HOST_LATENCY_SAMPLES ? (size_t)host->numLatencies
+                                                                   : HOST_LATENCY_SAMPLES;
+    if (count == 0)
+        return;
+    double* sorted = malloc(count * sizeof(double));
+    if (!sorted)
+        return;
+    memcpy(sorted, host->latencies, count * sizeof(double));
+    qsort(sorted, count, sizeof(double), compareDoubles);
+
+    const double sessionTicks = (double)host->tick * (double)host->numSessions;
+    fprintf(stderr, "sessions    %zu on %d workers, %u ticks in %.3f s (%llu late)\n", host->numSessions,
+        host->numWorkers, host->tick, seconds, (unsigned long long)lateTicks);
+    fprintf(stderr, "tick        p50 %.1f us  p99 %.1f us  max %.1f us\n", sorted[(count + 1) / 2 - 1] * 1e6,
+        sorted[(count * 99 + 99) / 100 - 1] * 1e6, sorted[count - 1] * 1e6);
+    if (sessionTicks > 0) {
+        double busy = 0;
+        for (size_t i = 0; i < count; i++)
+            busy += sorted[i];
+        fprintf(stderr, "session     %.3f us per tick, %.0f session ticks/s\n",
+            busy / (double)count * (double)host->numWorkers / (double)host->numSessions * 1e6, sessionTicks / seconds);
+    }
+    free(sorted);
+}
+
+static void printUsage(const char* program)
+{
+    fprintf(stderr,
+        "usage: %s [--threads N] [--tick-rate HZ] [--fast] [--ticks N] [--seed N] [--bag]\n"
+        "          [--socket PATH | --bench SESSIONS]\n",
+        program);
+}
+
+int main(int argc, char** argv)
+{
+    Host host;
+    memset(&host, 0, sizeof(host));
+    host.numWorkers = Pool_DefaultWorkers();
+    host.config = Game_DefaultConfig(1);
+    host.listener = -1;
+    const char* socketPath = NULL;
+    size_t benchSessions = 0;
+    uint32_t maxTicks = 0;
+    bool fast = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            host.numWorkers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc) {
+            const long tickRate = strtol(argv[++i], NULL, 10);
+            if (tickRate < 1 || tickRate > 1000) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            GameConfig_SetTickRate(&host.config, (uint16_t)tickRate);
+        } else if (strcmp(argv[i], "--fast") == 0) {
+            fast = true;
+        } else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            maxTicks = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            host.config.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--bag") == 0) {
+            host.config.randomizer = RANDOMIZER_BAG;
+        } else if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            benchSessions = strtoul(argv[++i], NULL, 10);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (host.numWorkers < 1 || (socketPath && benchSessions > 0)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+#ifdef _WIN32
+    if (benchSessions == 0) {
+        fprintf(stderr, "tetris-host: only --bench is supported on Windows\n");
+        return 1;
+    }
+#else
+    // A client that goes away mid-write must not take the host down with it
+    signal(SIGPIPE, SIG_IGN);
+    if (socketPath) {
+        host.listener = openSocket(socketPath);
+        if (host.listener < 0) {
+            fprintf(stderr, "tetris-host: cannot listen on %s\n", socketPath);
+            return 1;
+        }
+    } else if (benchSessions == 0) {
+        addClient(&host, 0, 1);
+    }
+#endif
+
+    host.shards = calloc((size_t)host.numWorkers, sizeof(Shard));
+    host.latencies = malloc(HOST_LATENCY_SAMPLES * sizeof(double));
+    pthread_t* threads = calloc((size_t)host.numWorkers, sizeof(pthread_t));
+    Worker* workers = calloc((size_t)host.numWorkers, sizeof(Worker));
+    if (!host.shards || !host.latencies || !threads || !workers) {
+        fprintf(stderr, "tetris-host: out of memory\n");
+        return 1;
+    }
+    for (int i = 0; i < host.numWorkers; i++)
+        host.shards[i].freeHead = HOST_NO_SLOT;
+    for (size_t i = 0; i < benchSessions; i++) {
+        size_t id;
+        if (!newSession(&host, host.config.seed + i, HOST_NO_CLIENT, &id)) {
+            fprintf(stderr, "tetris-host: out of memory\n");
+            return 1;
+        }
+    }
+
+    pthread_mutex_init(&host.lock, NULL);
+    pthread_cond_init(&host.start, NULL);
+    pthread_cond_init(&host.done, NULL);
+    for (int i = 0; i < host.numWorkers; i++) {
+        workers[i] = (Worker) { &host, i };
+        if (pthread_create(&threads[i], NULL, workerMain, &workers[i]) != 0) {
+            fprintf(stderr, "tetris-host: failed to start worker threads\n");
+            return 1;
+        }
+    }
+
+    const double tickSeconds = 1.0 / host.config.tickRate;
+    const double start = Pool_Now();
+    double nextTick = start;
+    uint64_t lateTicks = 0;
+    uint64_t botState = host.config.seed | 1;
+    for (;;) {
+        if (maxTicks > 0 && host.tick >= maxTicks)
+            break;
+        if (benchSessions == 0 && host.listener < 0 && !anyClientOpen(&host))
+            break;
+
+        // Commands that arrive before the tick is due go into its inboxes
+        if (benchSessions > 0) {
+            feedBots(&host, &botState);
+            if (!fast && Pool_Now() < nextTick) {
+                const double wait = nextTick - Pool_Now();
+                struct timespec sleep = { (time_t)wait, (long)((wait - (double)(time_t)wait) * 1e9) };
+                nanosleep(&sleep, NULL);
+            }
+        } else {
+#ifndef _WIN32
+            do {
+                pollClients(&host, fast ? 0 : nextTick - Pool_Now());
+                for (int i = 0; i < host.numClients; i++)
+                    runLines(&host, i);
+            } while (!fast && Pool_Now() < nextTick);
+#endif
+            reapClients(&host);
+        }
+
+        const double tickStart = Pool_Now();
+        runTick(&host);
+        sendOutboxes(&host);
+        const double now = Pool_Now();
+        host.latencies[host.numLatencies++ % HOST_LATENCY_SAMPLES] = now - tickStart;
+
+        nextTick += tickSeconds;
+        if (!fast && now > nextTick) {
+            // Behind schedule: skip ahead rather than race to catch up
+            lateTicks++;
+            nextTick = now;
+        }
+    }
+    const double seconds = Pool_Now() - start;
+
+    pthread_mutex_lock(&host.lock);
+    host.quit = true;
+    pthread_cond_broadcast(&host.start);
+    pthread_mutex_unlock(&host.lock);
+    for (int i = 0; i < host.numWorkers; i++)
+        pthread_join(threads[i], NULL);
+
+    printReport(&host, seconds, lateTicks);
+
+#ifndef _WIN32
+    if (host.listener >= 0) {
+        close(host.listener);
+        unlink(socketPath);
+    }
+#endif
+    for (int i = 0; i < host.numWorkers; i++) {
+        free(host.shards[i].sessions);
+        free(host.shards[i].output);
+    }
+    free(host.shards);
+    free(host.latencies);
+    free(threads);
+    free(workers);
+    pthread_mutex_destroy(&host.lock);
+    pthread_cond_destroy(&host.start);
+    pthread_cond_destroy(&host.done);
+    return 0;
+}
@@ -0,0 +1,410 @@
+// tetris-pack: packs asset files into one indexed blob and writes it out as
+// a C source file, so the game links its assets in and runs from any
+// directory as a single file.
+//
+// The blob starts with the magic "TBND" and the number of entries, then
+// one BUNDLE_ENTRY_SIZE index entry per file: its name, its file type as
+// raylib's *FromMemory loaders expect it (".png", ".wav", ...), and the
+// offset and size of its data. All integers are little-endian; see
+// src/bundle.h.
+//
+// A file given after --qoa must be a 16-bit PCM WAV; it is stored encoded as
+// QOA (https://qoaformat.org), which raylib streams directly and which is a
+// fifth of the size.
+
+#include "bundle.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+    char name[BUNDLE_NAME_SIZE];
+    char fileType[BUNDLE_TYPE_SIZE];
+    unsigned char* data;
+    size_t size;
+
+} PackedFile;
+
+static unsigned char* readFile(const char* path, size_t* size)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return NULL;
+
+    unsigned char* data = NULL;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        const long length = ftell(file);
+        if (length >= 0 && fseek(file, 0, SEEK_SET) == 0) {
+            data = malloc((size_t)length + 1);
+            if (data && fread(data, 1, (size_t)length, file) != (size_t)length) {
+                free(data);
+                data = NULL;
+            }
+            *size = (size_t)length;
+        }
+    }
+    fclose(file);
+    return data;
+}
+
+// QOA encoder. The stream is a file header, then frames of up to 256 slices
+// per channel; each slice packs a 4-bit scale factor and twenty 3-bit
+// residuals of a sign-sign LMS predictor into 64 bits.
+
+#define QOA_SLICE_LEN 20
+#define QOA_SLICES_PER_FRAME 256
+#define QOA_FRAME_LEN (QOA_SLICES_PER_FRAME * QOA_SLICE_LEN)
+#define QOA_LMS_LEN 4
+#define QOA_MAX_CHANNELS 8
+#define QOA_MAGIC 0x716f6166u // "qoaf"
+
+typedef struct
+{
+    int history[QOA_LMS_LEN];
+    int weights[QOA_LMS_LEN];
+
+} QoaLms;
+
+static const int QOA_QUANT[17] = { 7, 7, 7, 5, 5, 3, 3, 1, 0, 0, 2, 2, 4, 4, 6, 6, 6 };
+static const int QOA_SCALEFACTORS[16] = { 1, 7, 21, 45, 84, 138, 211, 304, 421, 562, 731, 928, 1157, 1419, 1715, 2048 };
+// The residual each quantized value stands for, in units of the scale factor
+static const double QOA_DEQUANT_STEPS[8] = { 0.75, -0.75, 2.5, -2.5, 4.5, -4.5, 7, -7 };
+
+static int qoaReciprocal[16];
+static int qoaDequant[16][8];
+
+static void qoaInitTables(void)
+{
+    for (int s = 0; s < 16; s++) {
+        const int scalefactor = QOA_SCALEFACTORS[s];
+        qoaReciprocal[s] = ((1 << 16) + scalefactor - 1) / scalefactor;
+        for (int q = 0; q < 8; q++) {
+            // Rounded half away from zero
+            const double value = scalefactor * QOA_DEQUANT_STEPS[q];
+            qoaDequant[s][q] = (int)(value < 0 ? value - 0.5 : value + 0.5);
+        }
+    }
+}
+
+static int clampInt(int value, int low, int high)
+{
+    return value < low ? low : value > high ? high : value;
+}
+
+static int sign(int value)
+{
+    return (value > 0) - (value < 0);
+}
+
+// value / scale factor, rounded away from zero
+static int qoaDivide(int value, int scalefactor)
+{
+    const int reciprocal = qoaReciprocal[scalefactor];
+    const int quotient = (value * reciprocal + (1 << 15)) >> 16;
+    return quotient + sign(value) - sign(quotient);
+}
+
+static int qoaPredict(const QoaLms* lms)
+{
+    int prediction = 0;
+    for (int i = 0; i < QOA_LMS_LEN; i++)
+        prediction += lms->weights[i] * lms->history[i];
+    return prediction >> 13;
+}
+
+static void qoaUpdate(QoaLms* lms, int sample, int residual)
+{
+    const int delta = residual >> 4;
+    for (int i = 0; i < QOA_LMS_LEN; i++)
+        lms->weights[i] += lms->history[i] < 0 ? -delta : delta;
+    for (int i = 0; i < QOA_LMS_LEN - 1; i++)
+        lms->history[i] = lms->history[i + 1];
+    lms->history[QOA_LMS_LEN - 1] = sample;
+}
+
+static void putU64(unsigned char** out, uint64_t value)
+{
+    for (int i = 7; i >= 0; i--)
+        *(*out)++ = (unsigned char)(value >> (8 * i));
+}
+
+// Picks the scale factor with the least squared error for one slice of one
+// channel, also penalizing predictor weights that grow large enough to
+// cause clicks, and advances the predictor past it.
+static uint64_t qoaEncodeSlice(const int16_t* samples, int channels, int length, QoaLms* lms, int* lastScalefactor)
+{
+    uint64_t bestRank = UINT64_MAX;
+    uint64_t bestSlice = 0;
+    QoaLms bestLms = *lms;
+    int bestScalefactor = 0;
+
+    for (int i = 0; i < 16; i++) {
+        // Neighbouring slices tend to share a scale factor, so the previous
+        // one is tried first and cuts the search short most often
+        const int scalefactor = (i + *lastScalefactor) % 16;
+        QoaLms trial = *lms;
+        uint64_t slice = (uint64_t)scalefactor;
+        uint64_t rank = 0;
+
+        for (int k = 0; k < length; k++) {
+            const int sample = samples[k * channels];
+            const int predicted = qoaPredict(&trial);
+            const int scaled = clampInt(qoaDivide(sample - predicted, scalefactor), -8, 8);
+            const int quantized = QOA_QUANT[scaled + 8];
+            const int dequantized = qoaDequant[scalefactor][quantized];
+            const int reconstructed = clampInt(predicted + dequantized, -32768, 32767);
+
+            int penalty = ((trial.weights[0] * trial.weights[0] + trial.weights[1] * trial.weights[1]
+                               + trial.weights[2] * trial.weights[2] + trial.weights[3] * trial.weights[3])
+                              >> 18)
+                - 0x8ff;
+            if (penalty < 0)
+                penalty = 0;
+            const int64_t error = sample - reconstructed;
+            rank += (uint64_t)(error * error) + (uint64_t)((int64_t)penalty * penalty);
+            if (rank > bestRank)
+                break;
+
+            qoaUpdate(&trial, reconstructed, dequantized);
+            slice = (slice << 3) | (uint64_t)quantized;
+        }
+
+        if (rank < bestRank) {
+            bestRank = rank;
+            bestSlice = slice;
+            bestLms = trial;
+            bestScalefactor = scalefactor;
+        }
+    }
+
+    *lms = bestLms;
+    *lastScalefactor = bestScalefactor;
+    // A short last slice keeps its residuals in the high bits
+    return bestSlice << ((QOA_SLICE_LEN - length) * 3);
+}
+
+static unsigned char* qoaEncode(const int16_t* samples, uint32_t numSamples, int channels, uint32_t sampleRate,
+    size_t* size)
+{
+    const size_t numFrames = (numSamples + QOA_FRAME_LEN - 1) / QOA_FRAME_LEN;
+    const size_t numSlices = (numSamples + QOA_SLICE_LEN - 1) / QOA_SLICE_LEN;
+    const size_t capacity = 8 + numFrames * (8 + 16 * (size_t)channels) + numSlices * 8 * (size_t)channels;
+    unsigned char* data = malloc(capacity);
+    if (!data)
+        return NULL;
+
+    QoaLms lms[QOA_MAX_CHANNELS];
+    int lastScalefactor[QOA_MAX_CHANNELS] = { 0 };
+    for (int c = 0; c < channels; c++)
+        lms[c] = (QoaLms) { { 0, 0, 0, 0 }, { 0, 0, -(1 << 13), 1 << 14 } };
+
+    unsigned char* out = data;
+    putU64(&out, (uint64_t)QOA_MAGIC << 32 | numSamples);
+    for (uint32_t start = 0; start < numSamples; start += QOA_FRAME_LEN) {
+        const uint32_t frameLength = numSamples - start < QOA_FRAME_LEN ? numSamples - start : QOA_FRAME_LEN;
+        const uint32_t frameSlices = (frameLength + QOA_SLICE_LEN - 1) / QOA_SLICE_LEN;
+        const uint32_t frameSize = 8 + 16 * (uint32_t)channels + 8 * frameSlices * (uint32_t)channels;
+        putU64(&out, (uint64_t)channels << 56 | (uint64_t)sampleRate << 32 | (uint64_t)frameLength << 16 | frameSize);
+
+        for (int c = 0; c < channels; c++) {
+            uint64_t history = 0;
+            uint64_t weights = 0;
+            for (int i = 0; i < QOA_LMS_LEN; i++) {
+                history = (history << 16) | (uint16_t)lms[c].history[i];
+                weights = (weights << 16) | (uint16_t)lms[c].weights[i];
+            }
+            putU64(&out, history);
+            putU64(&out, weights);
+        }
+
+        // Slices are interleaved by channel
+        for (uint32_t index = 0; index < frameLength; index += QOA_SLICE_LEN) {
+            const int length = frameLength - index < QOA_SLICE_LEN ? (int)(frameLength - index) : QOA_SLICE_LEN;
+            for (int c = 0; c < channels; c++) {
+                const int16_t* slice = samples + (size_t)(start + index) * (size_t)channels + (size_t)c;
+                putU64(&out, qoaEncodeSlice(slice, channels, length, &lms[c], &lastScalefactor[c]));
+            }
+        }
+    }
+
+    *size = (size_t)(out - data);
+    return data;
+}
+
+static uint32_t getU32(const unsigned char* bytes)
+{
+    return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+}
+
+// Re-encodes a 16-bit PCM WAV file as QOA in place.
+static bool convertToQoa(PackedFile* file)
+{
+    const unsigned char* wav = file->data;
+    if (file->size < 12 || memcmp(wav, "RIFF", 4) != 0 || memcmp(wav + 8, "WAVE", 4) != 0)
+        return false;
+
+    int channels = 0;
+    int bitsPerSample = 0;
+    uint32_t sampleRate = 0;
+    const unsigned char* pcm = NULL;
+    uint32_t pcmSize = 0;
+    for (size_t position = 12; position + 8 <= file->size;) {
+        const uint32_t chunkSize = getU32(wav + position + 4);
+        const unsigned char* chunk = wav + position + 8;
+        if (chunkSize > file->size - position - 8)
+            return false;
+        if (memcmp(wav + position, "fmt ", 4) == 0 && chunkSize >= 16) {
+            const int format = chunk[0] | chunk[1] << 8;
+            channels = chunk[2] | chunk[3] << 8;
+            sampleRate = getU32(chunk + 4);
+            bitsPerSample = chunk[14] | chunk[15] << 8;
+            if (format != 1)
+                return false;
+        } else if (memcmp(wav + position, "data", 4) == 0) {
+            pcm = chunk;
+            pcmSize = chunkSize;
+        }
+        position += 8 + chunkSize + (chunkSize & 1);
+    }
+    if (!pcm || bitsPerSample != 16 || channels < 1 || channels > QOA_MAX_CHANNELS || sampleRate == 0
+        || sampleRate >= 1u << 24)
+        return false;
+
+    const uint32_t numSamples = pcmSize / 2 / (uint32_t)channels;
+    int16_t* samples = malloc((size_t)numSamples * (size_t)channels * sizeof(int16_t) + 1);
+    if (!samples)
+        return false;
+    for (size_t i = 0; i < (size_t)numSamples * (size_t)channels; i++)
+        samples[i] = (int16_t)(uint16_t)(pcm[2 * i] | pcm[2 * i + 1] << 8);
+
+    qoaInitTables();
+    size_t size;
+    unsigned char* qoa = qoaEncode(samples, numSamples, channels, sampleRate, &size);
+    free(samples);
+    if (!qoa)
+        return false;
+
+    free(file->data);
+    file->data = qoa;
+    file->size = size;
+    strcpy(file->fileType, ".qoa");
+    char* extension = strrchr(file->name, '.');
+    if (extension && strlen(extension) == 4)
+        strcpy(extension, ".qoa");
+    return true;
+}
+
+typedef struct
+{
+    FILE* file;
+    size_t length;
+
+} Emitter;
+
+static void emitByte(Emitter* emitter, unsigned char value)
+{
+    fprintf(emitter->file, "%u,%s", value, ++emitter->length % 24 == 0 ? "\n" : "");
+}
+
+static void emitU32(Emitter* emitter, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        emitByte(emitter, (unsigned char)(value >> (8 * i)));
+}
+
+static bool writeBundle(const char* path, const PackedFile* files, size_t numFiles)
+{
+    Emitter emitter = { fopen(path, "w"), 0 };
+    if (!emitter.file)
+        return false;
+
+    fprintf(emitter.file, "// Generated by tetris-pack; do not edit.\n\n");
+    fprintf(emitter.file, "#include <stddef.h>\n\n");
+    fprintf(emitter.file, "const unsigned char ASSET_BUNDLE[] = {\n");
+
+    for (int i = 0; i < 4; i++)
+        emitByte(&emitter, (unsigned char)BUNDLE_MAGIC[i]);
+    emitU32(&emitter, (uint32_t)numFiles);
+    size_t offset = BUNDLE_HEADER_SIZE + numFiles * BUNDLE_ENTRY_SIZE;
+    for (size_t i = 0; i < numFiles; i++) {
+        for (size_t k = 0; k < BUNDLE_NAME_SIZE; k++)
+            emitByte(&emitter, (unsigned char)files[i].name[k]);
+        for (size_t k = 0; k < BUNDLE_TYPE_SIZE; k++)
+            emitByte(&emitter, (unsigned char)files[i].fileType[k]);
+        emitU32(&emitter, (uint32_t)offset);
+        emitU32(&emitter, (uint32_t)files[i].size);
+        offset += files[i].size;
+    }
+    for (size_t i = 0; i < numFiles; i++) {
+        for (size_t k = 0; k < files[i].size; k++)
+            emitByte(&emitter, files[i].data[k]);
+    }
+    fprintf(emitter.file, "\n};\n\nconst size_t ASSET_BUNDLE_SIZE = sizeof(ASSET_BUNDLE);\n");
+
+    const bool ok = !ferror(emitter.file);
+    return fclose(emitter.file) == 0 && ok;
+}
+
+static void printUsage(const char* program)
+{
+    fprintf(stderr, "usage: %s OUTPUT.c [--qoa] FILE...\n", program);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    PackedFile* files = calloc((size_t)argc, sizeof(PackedFile));
+    if (!files) {
+        fprintf(stderr, "tetris-pack: out of memory\n");
+        return 1;
+    }
+    size_t numFiles = 0;
+    bool qoa = false;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--qoa") == 0) {
+            qoa = true;
+            continue;
+        }
+
+        // Entries are named by their path below assets/
+        const char* path = argv[i];
+        const char* name = strncmp(path, "assets/", 7) == 0 ? path + 7 : path;
+        const char* extension = strrchr(name, '.');
+        PackedFile* file = &files[numFiles++];
+        if (strlen(name) >= BUNDLE_NAME_SIZE || !extension || strlen(extension) >= BUNDLE_TYPE_SIZE) {
+            fprintf(stderr, "tetris-pack: name or extension too long: %s\n", path);
+            return 1;
+        }
+        strcpy(file->name, name);
+        strcpy(file->fileType, extension);
+
+        file->data = readFile(path, &file->size);
+        if (!file->data) {
+            fprintf(stderr, "tetris-pack: cannot read %s\n", path);
+            return 1;
+        }
+        if (qoa) {
+            const size_t wavSize = file->size;
+            if (!convertToQoa(file)) {
+                fprintf(stderr, "tetris-pack: %s is not a 16-bit PCM WAV file\n", path);
+                return 1;
+            }
+            printf("%s: %zu bytes of WAV as %zu bytes of QOA\n", path, wavSize, file->size);
+            qoa = false;
+        }
+    }
+
+    if (!writeBundle(argv[1], files, numFiles)) {
+        fprintf(stderr, "tetris-pack: cannot write %s\n", argv[1]);
+        return 1;
+    }
+    for (size_t i = 0; i < numFiles; i++)
+        free(files[i].data);
+    free(files);
+    return 0;
+}
@@ -0,0 +1,162 @@
+#include "pool.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Number of tasks a worker claims from its own range at a time; small
+// enough to keep ranges stealable, large enough to keep the lock cold.
+#define POOL_CHUNK 4
+
+typedef struct
+{
+    Pool* pool;
+    int worker;
+
+} PoolThread;
+
+double Pool_Now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+int Pool_DefaultWorkers(void)
+{
+    const long online = sysconf(_SC_NPROCESSORS_ONLN);
+    return online > 0 ? (int)online : 1;
+}
+
+static size_t remainingIn(PoolRange* range)
+{
+    pthread_mutex_lock(&range->lock);
+    const size_t remaining = range->end - range->begin;
+    pthread_mutex_unlock(&range->lock);
+    return remaining;
+}
+
+static size_t claimOwn(PoolRange* range, size_t* begin)
+{
+    pthread_mutex_lock(&range->lock);
+    const size_t available = range->end - range->begin;
+    const size_t count = available < POOL_CHUNK ? available : POOL_CHUNK;
+    *begin = range->begin;
+    range->begin += count;
+    pthread_mutex_unlock(&range->lock);
+    return count;
+}
+
+// Moves the back half of the fullest other range into the thief's range.
+static int steal(Pool* pool, int thief)
+{
+    for (;;) {
+        int victim = -1;
+        size_t most = 0;
+        for (int i = 0; i < pool->numWorkers; i++) {
+            if (i == thief)
+                continue;
+            const size_t remaining = remainingIn(&pool->ranges[i]);
+            if (remaining > most) {
+                most = remaining;
+                victim = i;
+            }
+        }
+        if (victim < 0)
+            return 0;
+
+        PoolRange* range = &pool->ranges[victim];
+        pthread_mutex_lock(&range->lock);
+        const size_t remaining = range->end - range->begin;
+        const size_t half = remaining - remaining / 2;
+        size_t begin = 0;
+        if (remaining > 0) {
+            begin = range->end - half;
+            range->end = begin;
+        }
+        pthread_mutex_unlock(&range->lock);
+
+        if (remaining > 0) {
+            PoolRange* own = &pool->ranges[thief];
+            pthread_mutex_lock(&own->lock);
+            own->begin = begin;
+            own->end = begin + half;
+            pthread_mutex_unlock(&own->lock);
+            return 1;
+        }
+        // The victim drained its range while we were choosing it; look again.
+    }
+}
+
+static void* workerMain(void* argument)
+{
+    PoolThread* thread = argument;
+    Pool* pool = thread->pool;
+    PoolWorkerStats* stats = &pool->stats[thread->worker];
+    const double start = Pool_Now();
+
+    for (;;) {
+        size_t begin;
+        const size_t count = claimOwn(&pool->ranges[thread->worker], &begin);
+        if (count == 0) {
+            if (!steal(pool, thread->worker))
+                break;
+            stats->steals++;
+            continue;
+        }
+        for (size_t i = begin; i < begin + count; i++)
+            pool->task(pool->context, i, thread->worker);
+        stats->tasksRun += count;
+    }
+
+    stats->busySeconds = Pool_Now() - start;
+    return NULL;
+}
+
+int Pool_Run(int numWorkers, size_t numTasks, PoolTask task, void* context, PoolWorkerStats* stats)
+{
+    if (numWorkers < 1)
+        numWorkers = 1;
+
+    Pool pool = { numWorkers, task, context, NULL, NULL };
+    pool.ranges = calloc((size_t)numWorkers, sizeof(PoolRange));
+    pool.stats = calloc((size_t)numWorkers, sizeof(PoolWorkerStats));
+    PoolThread* threads = calloc((size_t)numWorkers, sizeof(PoolThread));
+    pthread_t* handles = calloc((size_t)numWorkers, sizeof(pthread_t));
+    if (!pool.ranges || !pool.stats || !threads || !handles) {
+        free(pool.ranges);
+        free(pool.stats);
+        free(threads);
+        free(handles);
+        return -1;
+    }
+
+    for (int i = 0; i < numWorkers; i++) {
+        pthread_mutex_init(&pool.ranges[i].lock, NULL);
+        pool.ranges[i].begin = numTasks * (size_t)i / (size_t)numWorkers;
+        pool.ranges[i].end = numTasks * (size_t)(i + 1) / (size_t)numWorkers;
+        threads[i] = (PoolThread) { &pool, i };
+    }
+
+    // The calling thread doubles as worker 0. Should a thread fail to
+    // start, its range is simply stolen by the others.
+    int started = 1;
+    for (int i = 1; i < numWorkers; i++) {
+        if (pthread_create(&handles[i], NULL, workerMain, &threads[i]) != 0)
+            break;
+        started++;
+    }
+    workerMain(&threads[0]);
+    for (int i = 1; i < started; i++)
+        pthread_join(handles[i], NULL);
+
+    if (stats)
+        memcpy(stats, pool.stats, (size_t)numWorkers * sizeof(PoolWorkerStats));
+    for (int i = 0; i < numWorkers; i++)
+        pthread_mutex_destroy(&pool.ranges[i].lock);
+    free(pool.ranges);
+    free(pool.stats);
+    free(threads);
+    free(handles);
+    return 0;
+}
@@ -0,0 +1,50 @@
+#ifndef TETRIS_POOL_H
+#define TETRIS_POOL_H
+
+// Work-stealing thread pool for running many independent tasks, such as
+// whole simulated games. Every worker starts with an even slice of the task
+// range and works through it front to back; a worker that runs dry steals
+// the back half of the busiest-looking victim's remaining slice.
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef void (*PoolTask)(void* context, size_t task, int worker);
+
+typedef struct
+{
+    size_t tasksRun;
+    size_t steals;
+    double busySeconds;
+
+} PoolWorkerStats;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    size_t begin;
+    size_t end;
+
+} PoolRange;
+
+typedef struct
+{
+    int numWorkers;
+    PoolTask task;
+    void* context;
+    PoolRange* ranges;
+    PoolWorkerStats* stats;
+
+} Pool;
+
+// Runs task(context, i, worker) for every i in [0, numTasks) on numWorkers
+// threads and blocks until all are done. stats, if not NULL, receives one
+// entry per worker. Returns 0 on success.
+int Pool_Run(int numWorkers, size_t numTasks, PoolTask task, void* context, PoolWorkerStats* stats);
+
+int Pool_DefaultWorkers(void);
+
+double Pool_Now(void);
+
+#endif // TETRIS_POOL_H
@@ -0,0 +1,133 @@
+// tetris-replay: re-simulates recorded replays headlessly, as fast as
+// possible, and checks each one's final score, lines, pieces and board hash.
+
+#include "core/tetris_core.h"
+#include "pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+    const char* path;
+    uint8_t* data;
+    size_t length;
+    ReplayStatus status;
+    ReplaySummary summary;
+
+} ReplayFile;
+
+static const char* STATUS_NAMES[] = { "ok", "corrupt", "truncated", "mismatch" };
+
+static bool loadFile(ReplayFile* replay)
+{
+    FILE* file = fopen(replay->path, "rb");
+    if (!file)
+        return false;
+
+    size_t capacity = REPLAY_BUFFER_SIZE;
+    replay->data = malloc(capacity);
+    replay->length = 0;
+    while (replay->data) {
+        replay->length += fread(replay->data + replay->length, 1, capacity - replay->length, file);
+        if (replay->length < capacity)
+            break;
+        capacity *= 2;
+        uint8_t* grown = realloc(replay->data, capacity);
+        if (!grown) {
+            free(replay->data);
+            replay->data = NULL;
+            break;
+        }
+        replay->data = grown;
+    }
+    const bool ok = replay->data != NULL && !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+static void playReplay(void* context, size_t index, int worker)
+{
+    (void)worker;
+    ReplayFile* replay = &((ReplayFile*)context)[index];
+    Game game;
+    replay->status = Replay_Play(replay->data, replay->length, &game, &replay->summary);
+}
+
+static void printUsage(const char* program)
+{
+    fprintf(stderr, "usage: %s [--threads N] [--verbose] FILE...\n", program);
+}
+
+int main(int argc, char** argv)
+{
+    int numThreads = Pool_DefaultWorkers();
+    int verbose = 0;
+    int first = 1;
+    for (; first < argc && strncmp(argv[first], "--", 2) == 0; first++) {
+        if (strcmp(argv[first], "--verbose") == 0) {
+            verbose = 1;
+        } else if (strcmp(argv[first], "--threads") == 0 && first + 1 < argc) {
+            numThreads = atoi(argv[++first]);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    const size_t numReplays = (size_t)(argc - first);
+    if (numReplays == 0 || numThreads < 1) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    ReplayFile* replays = calloc(numReplays, sizeof(ReplayFile));
+    if (!replays) {
+        fprintf(stderr, "tetris-replay: out of memory\n");
+        return 1;
+    }
+    size_t totalBytes = 0;
+    for (size_t i = 0; i < numReplays; i++) {
+        replays[i].path = argv[first + i];
+        if (!loadFile(&replays[i])) {
+            fprintf(stderr, "tetris-replay: cannot read %s\n", replays[i].path);
+            return 1;
+        }
+        totalBytes += replays[i].length;
+    }
+
+    // Files are loaded up front so that only re-simulation is timed
+    const double start = Pool_Now();
+    if (Pool_Run(numThreads, numReplays, playReplay, replays, NULL) != 0) {
+        fprintf(stderr, "tetris-replay: failed to start worker pool\n");
+        return 1;
+    }
+    const double seconds = Pool_Now() - start;
+
+    size_t failures = 0;
+    uint64_t ticks = 0;
+    for (size_t i = 0; i < numReplays; i++) {
+        const ReplayFile* replay = &replays[i];
+        if (replay->status != REPLAY_OK)
+            failures++;
+        else
+            ticks += replay->summary.ticks;
+        if (verbose || replay->status != REPLAY_OK) {
+            printf("%-9s %s", STATUS_NAMES[replay->status], replay->path);
+            if (replay->status == REPLAY_OK || replay->status == REPLAY_MISMATCH) {
+                printf("  score %u lines %u pieces %u ticks %u hash %016llx", replay->summary.score,
+                    replay->summary.lines, replay->summary.pieces, replay->summary.ticks,
+                    (unsigned long long)replay->summary.boardHash);
+            }
+            printf("\n");
+        }
+    }
+
+    printf("replays     %zu (%zu bytes) on %d threads in %.3f s\n", numReplays, totalBytes, numThreads, seconds);
+    printf("throughput  %.0f replays/s, %.0f ticks/s\n", (double)numReplays / seconds, (double)ticks / seconds);
+    printf("failed      %zu\n", failures);
+
+    for (size_t i = 0; i < numReplays; i++)
+        free(replays[i].data);
+    free(replays);
+    return failures > 0 ? 1 : 0;
+}
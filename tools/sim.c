@@ -0,0 +1,447 @@
+// tetris-sim: plays many headless games in parallel and reports throughput
+// and score statistics for a policy, or with --batch compares the batch
+// engine with one board at a time on random drops.
+
+#include "core/tetris_core.h"
+#include "pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+    uint32_t score;
+    uint32_t lines;
+    uint32_t pieces;
+
+} GameResult;
+
+typedef struct
+{
+    uint64_t seed;
+    RandomizerType randomizer;
+    PolicyType policy;
+    const char* script;
+    uint32_t maxPieces;
+    GameResult* results;
+    int depth;
+    // Shared by every game of a lookahead run, with one set of statistics
+    // per worker
+    TranspositionTable* table;
+    TranspositionStats* tableStats;
+    // The same games played BATCH_LANES at a time, in --batch mode
+    GameResult* batchResults;
+    size_t numGames;
+
+} Simulation;
+
+static const char* POLICY_NAMES[NUM_POLICIES] = { "random", "scripted", "heuristic", "lookahead" };
+static const char* BATCH_KERNEL_NAMES[NUM_BATCH_KERNELS] = { "scalar", "sse2", "avx2" };
+
+// SplitMix64, to turn consecutive game indices into unrelated seeds.
+static uint64_t mixSeed(uint64_t value)
+{
+    value += 0x9e3779b97f4a7c15ULL;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+static void playGame(void* context, size_t index, int worker)
+{
+    const Simulation* simulation = context;
+    const uint64_t seed = mixSeed(simulation->seed + index);
+
+    GameConfig config = Game_DefaultConfig(seed);
+    config.randomizer = simulation->randomizer;
+    Game game;
+    Game_Init(&game, &config);
+    Policy policy;
+    Policy_Init(&policy, simulation->policy, seed, simulation->script);
+    policy.depth = simulation->depth;
+    policy.table = simulation->table;
+    // Counted per game and merged into the worker's once at the end, too
+    // rarely for neighbouring workers' entries sharing a line to matter
+    TranspositionStats tableStats = { 0, 0, 0, 0 };
+    policy.tableStats = &tableStats;
+
+    while (!game.gameOver && game.pieces < simulation->maxPieces)
+        Policy_PlayPiece(&policy, &game);
+
+    simulation->results[index] = (GameResult) { game.score, game.lines, game.pieces };
+    if (simulation->table)
+        TranspositionStats_Add(&simulation->tableStats[worker], &tableStats);
+}
+
+// Batch mode: every game drops random blocks, each turned at random and moved
+// to a random column within the walls, straight down until one doesn't fit.
+// Only lines and pieces are counted. Each game is played once on its own
+// board and once in a lane of a BoardBatch, and the two must agree.
+
+typedef struct
+{
+    Randomizer randomizer;
+    Rng rng;
+
+} DropSource;
+
+static void initDropSource(DropSource* source, const Simulation* simulation, size_t index)
+{
+    const uint64_t seed = mixSeed(simulation->seed + index);
+    Randomizer_Init(&source->randomizer, simulation->randomizer, seed);
+    Rng_Seed(&source->rng, seed, 1);
+}
+
+static Block nextDrop(DropSource* source)
+{
+    Block block = Block_Init((BlockType)Randomizer_Next(&source->randomizer));
+    const uint32_t rotations = Rng_Below(&source->rng, ROTATION_STATES);
+    for (uint32_t i = 0; i < rotations; i++)
+        Block_Rotate(&block);
+    const PieceShape* shape = Block_GetShape(&block);
+    const uint32_t columns = (uint32_t)(BOARD_COLUMNS - (shape->right - shape->left));
+    block.columnOffset = (int8_t)((int)Rng_Below(&source->rng, columns) - shape->left);
+    return block;
+}
+
+static void dropGame(void* context, size_t index, int worker)
+{
+    (void)worker;
+    const Simulation* simulation = context;
+    DropSource source;
+    initDropSource(&source, simulation, index);
+    Board board;
+    Board_Init(&board);
+
+    GameResult result = { 0, 0, 0 };
+    while (result.pieces < simulation->maxPieces) {
+        Block block = nextDrop(&source);
+        if (!Board_CanPlace(&board, &block))
+            break;
+        while (Board_TryMove(&board, &block, (Position) { 1, 0 }))
+            ;
+        Board_PlaceBlock(&board, &block);
+        result.lines += Board_ClearFullRows(&board);
+        result.pieces++;
+    }
+    simulation->results[index] = result;
+}
+
+// Plays games [group * BATCH_LANES, (group + 1) * BATCH_LANES) together, one
+// per lane, until every lane's game is over.
+static void dropGames(void* context, size_t group, int worker)
+{
+    (void)worker;
+    const Simulation* simulation = context;
+    const size_t first = group * BATCH_LANES;
+    DropSource sources[BATCH_LANES];
+    GameResult results[BATCH_LANES];
+    BoardBatch batch;
+    BoardBatch_Init(&batch);
+
+    BatchLanes active = 0;
+    for (int lane = 0; lane < BATCH_LANES && first + (size_t)lane < simulation->numGames; lane++) {
+        initDropSource(&sources[lane], simulation, first + (size_t)lane);
+        results[lane] = (GameResult) { 0, 0, 0 };
+        if (simulation->maxPieces > 0)
+            active |= (BatchLanes)(1u << lane);
+    }
+
+    while (active != 0) {
+        for (BatchLanes lanes = active; lanes != 0; lanes &= lanes - 1) {
+            const int lane = Bits_LowestIndex(lanes);
+            const Block block = nextDrop(&sources[lane]);
+            BoardBatch_SetBlock(&batch, lane, &block);
+        }
+        const BatchLanes fits = BoardBatch_Fits(&batch) & active;
+        for (BatchLanes falling = fits; falling != 0;)
+            falling = BoardBatch_StepDown(&batch, falling);
+        BoardBatch_Lock(&batch, fits);
+
+        BatchLanes full[BOARD_ROWS];
+        for (BatchLanes lanes = BoardBatch_FullRows(&batch, full) & fits; lanes != 0; lanes &= lanes - 1) {
+            const int lane = Bits_LowestIndex(lanes);
+            results[lane].lines += BoardBatch_ClearFullRows(&batch, lane);
+        }
+
+        active = fits;
+        for (BatchLanes lanes = fits; lanes != 0; lanes &= lanes - 1) {
+            const int lane = Bits_LowestIndex(lanes);
+            if (++results[lane].pieces == simulation->maxPieces)
+                active &= (BatchLanes) ~(1u << lane);
+        }
+    }
+
+    for (int lane = 0; lane < BATCH_LANES && first + (size_t)lane < simulation->numGames; lane++)
+        simulation->batchResults[first + (size_t)lane] = results[lane];
+}
+
+// Returns wall-clock seconds.
+static double runDrops(Simulation* simulation, int numThreads, bool batched)
+{
+    const size_t numTasks = batched ? (simulation->numGames + BATCH_LANES - 1) / BATCH_LANES : simulation->numGames;
+    const double start = Pool_Now();
+    if (Pool_Run(numThreads, numTasks, batched ? dropGames : dropGame, simulation, NULL) != 0) {
+        fprintf(stderr, "tetris-sim: failed to start worker pool\n");
+        exit(1);
+    }
+    return Pool_Now() - start;
+}
+
+// Returns the number of games on which the two runs disagree.
+static size_t printDropReport(const Simulation* simulation, int numThreads, double scalarSeconds, double batchSeconds)
+{
+    const size_t numGames = simulation->numGames;
+    uint64_t pieces = 0;
+    uint64_t lines = 0;
+    size_t mismatches = 0;
+    for (size_t i = 0; i < numGames; i++) {
+        const GameResult* scalar = &simulation->results[i];
+        const GameResult* batched = &simulation->batchResults[i];
+        pieces += scalar->pieces;
+        lines += scalar->lines;
+        mismatches += scalar->pieces != batched->pieces || scalar->lines != batched->lines;
+    }
+
+    printf("mode        random drops, %d lanes, %s kernel\n", BATCH_LANES, BATCH_KERNEL_NAMES[BoardBatch_Kernel()]);
+    printf("games       %zu on %d threads\n", numGames, numThreads);
+    printf("scalar      %.3f s, %.0f pieces/s\n", scalarSeconds, (double)pieces / scalarSeconds);
+    printf("batch       %.3f s, %.0f pieces/s, %.2fx\n", batchSeconds, (double)pieces / batchSeconds,
+        scalarSeconds / batchSeconds);
+    printf("pieces      %llu total, %.1f per game\n", (unsigned long long)pieces, (double)pieces / (double)numGames);
+    printf("lines       %llu total, %.2f per game\n", (unsigned long long)lines, (double)lines / (double)numGames);
+    printf("agree       %s\n", mismatches ? "no" : "yes");
+    return mismatches;
+}
+
+static int compareScores(const void* a, const void* b)
+{
+    const uint32_t left = ((const GameResult*)a)->score;
+    const uint32_t right = ((const GameResult*)b)->score;
+    return (left > right) - (left < right);
+}
+
+static uint32_t percentile(const GameResult* sorted, size_t count, double fraction)
+{
+    size_t index = (size_t)(fraction * (double)(count - 1) + 0.5);
+    return sorted[index].score;
+}
+
+// Runs every game once on numThreads workers, starting from an empty table;
+// returns wall-clock seconds.
+static double runBatch(Simulation* simulation, size_t numGames, int numThreads, PoolWorkerStats* stats)
+{
+    if (simulation->table) {
+        TranspositionTable_Clear(simulation->table);
+        memset(simulation->tableStats, 0, (size_t)numThreads * sizeof(TranspositionStats));
+    }
+    const double start = Pool_Now();
+    if (Pool_Run(numThreads, numGames, playGame, simulation, stats) != 0) {
+        fprintf(stderr, "tetris-sim: failed to start worker pool\n");
+        exit(1);
+    }
+    return Pool_Now() - start;
+}
+
+static void printReport(const Simulation* simulation, size_t numGames, int numThreads, double seconds, const PoolWorkerStats* stats)
+{
+    GameResult* sorted = malloc(numGames * sizeof(GameResult));
+    if (!sorted) {
+        fprintf(stderr, "tetris-sim: out of memory\n");
+        exit(1);
+    }
+    memcpy(sorted, simulation->results, numGames * sizeof(GameResult));
+    qsort(sorted, numGames, sizeof(GameResult), compareScores);
+
+    uint64_t pieces = 0;
+    uint64_t lines = 0;
+    uint64_t score = 0;
+    for (size_t i = 0; i < numGames; i++) {
+        pieces += sorted[i].pieces;
+        lines += sorted[i].lines;
+        score += sorted[i].score;
+    }
+
+    printf("policy      %s\n", POLICY_NAMES[simulation->policy]);
+    printf("games       %zu on %d threads in %.3f s\n", numGames, numThreads, seconds);
+    printf("throughput  %.0f games/s, %.0f pieces/s\n", (double)numGames / seconds, (double)pieces / seconds);
+    printf("pieces      %llu total, %.1f per game\n", (unsigned long long)pieces, (double)pieces / (double)numGames);
+    printf("lines       %llu total, %.2f per game\n", (unsigned long long)lines, (double)lines / (double)numGames);
+    printf("score       mean %.2f  min %u  p50 %u  p90 %u  p99 %u  max %u\n",
+        (double)score / (double)numGames, sorted[0].score, percentile(sorted, numGames, 0.5),
+        percentile(sorted, numGames, 0.9), percentile(sorted, numGames, 0.99), sorted[numGames - 1].score);
+
+    // Ten equal-width buckets up to the best score
+    const uint32_t top = sorted[numGames - 1].score;
+    const uint32_t width = top / 10 + 1;
+    size_t buckets[10] = { 0 };
+    for (size_t i = 0; i < numGames; i++)
+        buckets[sorted[i].score / width]++;
+    for (int i = 0; i < 10; i++) {
+        if (buckets[i] > 0)
+            printf("  %6u..%-6u %zu\n", (unsigned)(i * width), (unsigned)((i + 1) * width - 1), buckets[i]);
+    }
+
+    if (simulation->table) {
+        TranspositionStats table = { 0, 0, 0, 0 };
+        for (int i = 0; i < numThreads; i++)
+            TranspositionStats_Add(&table, &simulation->tableStats[i]);
+        const uint64_t probes = table.hits + table.misses;
+        printf("table       %zu KB, %llu probes, %.1f%% hits, %llu collisions, %llu stores\n",
+            TranspositionTable_Bytes(simulation->table) / 1024, (unsigned long long)probes,
+            probes ? 100.0 * (double)table.hits / (double)probes : 0.0, (unsigned long long)table.collisions,
+            (unsigned long long)table.stores);
+    }
+
+    printf("threads\n");
+    for (int i = 0; i < numThreads; i++) {
+        printf("  #%-3d games %-8zu steals %-4zu busy %.3f s\n", i, stats[i].tasksRun, stats[i].steals,
+            stats[i].busySeconds);
+    }
+    free(sorted);
+}
+
+static void printUsage(const char* program)
+{
+    fprintf(stderr,
+        "usage: %s [--games N] [--threads N] [--seed N] [--policy random|scripted|heuristic|lookahead]\n"
+        "          [--script STEPS] [--max-pieces N] [--depth N] [--table-mb N] [--bag] [--scaling | --batch]\n",
+        program);
+}
+
+int main(int argc, char** argv)
+{
+    Simulation simulation
+        = { 1, RANDOMIZER_UNIFORM, POLICY_RANDOM, "D", 100000, NULL, POLICY_DEFAULT_DEPTH, NULL, NULL, NULL, 0 };
+    size_t tableMegabytes = 64;
+    size_t numGames = 10000;
+    int numThreads = Pool_DefaultWorkers();
+    int scaling = 0;
+    int batch = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* option = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(option, "--bag") == 0) {
+            simulation.randomizer = RANDOMIZER_BAG;
+            continue;
+        }
+        if (strcmp(option, "--scaling") == 0) {
+            scaling = 1;
+            continue;
+        }
+        if (strcmp(option, "--batch") == 0) {
+            batch = 1;
+            continue;
+        }
+        if (value == NULL) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        i++;
+        if (strcmp(option, "--games") == 0) {
+            numGames = strtoull(value, NULL, 10);
+        } else if (strcmp(option, "--threads") == 0) {
+            numThreads = atoi(value);
+        } else if (strcmp(option, "--seed") == 0) {
+            simulation.seed = strtoull(value, NULL, 10);
+        } else if (strcmp(option, "--max-pieces") == 0) {
+            simulation.maxPieces = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(option, "--depth") == 0) {
+            simulation.depth = atoi(value);
+        } else if (strcmp(option, "--table-mb") == 0) {
+            tableMegabytes = strtoull(value, NULL, 10);
+        } else if (strcmp(option, "--script") == 0) {
+            simulation.script = value;
+        } else if (strcmp(option, "--policy") == 0) {
+            int found = 0;
+            for (int p = 0; p < NUM_POLICIES; p++) {
+                if (strcmp(value, POLICY_NAMES[p]) == 0) {
+                    simulation.policy = (PolicyType)p;
+                    found = 1;
+                }
+            }
+            if (!found) {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (numGames == 0 || numThreads < 1 || simulation.depth < 2 || simulation.depth > POLICY_MAX_DEPTH
+        || (scaling && batch)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (simulation.policy == POLICY_SCRIPTED && !Policy_IsValidScript(simulation.script)) {
+        fprintf(stderr, "tetris-sim: scripts use L R U D . and must contain D or .\n");
+        return 1;
+    }
+
+    simulation.numGames = numGames;
+    simulation.results = malloc(numGames * sizeof(GameResult));
+    PoolWorkerStats* stats = calloc((size_t)numThreads, sizeof(PoolWorkerStats));
+    if (!simulation.results || !stats) {
+        fprintf(stderr, "tetris-sim: out of memory\n");
+        return 1;
+    }
+
+    if (batch) {
+        simulation.batchResults = malloc(numGames * sizeof(GameResult));
+        if (!simulation.batchResults) {
+            fprintf(stderr, "tetris-sim: out of memory\n");
+            return 1;
+        }
+        const double scalarSeconds = runDrops(&simulation, numThreads, false);
+        const double batchSeconds = runDrops(&simulation, numThreads, true);
+        const size_t mismatches = printDropReport(&simulation, numThreads, scalarSeconds, batchSeconds);
+        if (mismatches > 0)
+            fprintf(stderr, "tetris-sim: the batch engine disagreed on %zu games\n", mismatches);
+        free(simulation.batchResults);
+        free(stats);
+        free(simulation.results);
+        return mismatches > 0;
+    }
+
+    // The lookahead policy runs without a table when given no memory for one
+    TranspositionTable table;
+    if (simulation.policy == POLICY_LOOKAHEAD && tableMegabytes > 0) {
+        simulation.tableStats = calloc((size_t)numThreads, sizeof(TranspositionStats));
+        if (!simulation.tableStats || !TranspositionTable_Init(&table, tableMegabytes << 20)) {
+            fprintf(stderr, "tetris-sim: out of memory\n");
+            return 1;
+        }
+        simulation.table = &table;
+    }
+
+    const double seconds = runBatch(&simulation, numGames, numThreads, stats);
+    printReport(&simulation, numGames, numThreads, seconds, stats);
+
+    // Same batch again on 1, 2, 4, ... threads; the seeds are identical, so
+    // only the wall-clock time may differ.
+    if (scaling) {
+        double single = 0;
+        printf("scaling\n");
+        for (int threads = 1;; threads *= 2) {
+            if (threads > numThreads)
+                threads = numThreads;
+            const double elapsed = runBatch(&simulation, numGames, threads, stats);
+            if (threads == 1)
+                single = elapsed;
+            printf("  %3d threads  %.3f s  speedup %.2fx  efficiency %.0f%%\n", threads, elapsed, single / elapsed,
+                100.0 * single / elapsed / threads);
+            if (threads == numThreads)
+                break;
+        }
+    }
+
+    if (simulation.table)
+        TranspositionTable_Free(simulation.table);
+    free(simulation.tableStats);
+    free(stats);
+    free(simulation.results);
+    return 0;
+}